@@ -247,6 +247,181 @@ int nfp_abm_ctrl_read_q_xstats(struct nfp_abm_link *alink,
 				 band, queue, true, &xstats->ecn_marked);
 }
 
+/* Per-link stats snapshot holds, for each band, the link's contiguous
+ * queue range of the QM stats, the level/backlog area and (in per-band
+ * case) the basic queue stats.
+ */
+#define NFP_ABM_SNAP_STRIDE \
+	(NFP_QMSTAT_STRIDE + NFP_QLVL_STRIDE + NFP_Q_STAT_STRIDE)
+
+size_t nfp_abm_ctrl_stats_snap_size(struct nfp_abm_link *alink)
+{
+	return alink->abm->num_bands * alink->total_queues *
+	       NFP_ABM_SNAP_STRIDE;
+}
+
+static u8 *
+nfp_abm_ctrl_snap_area(struct nfp_abm_link *alink, const u8 *buf,
+		       unsigned int stride, unsigned int area_off,
+		       unsigned int band)
+{
+	unsigned int n = alink->total_queues;
+
+	return (u8 *)buf + alink->abm->num_bands * n * area_off +
+	       band * n * stride;
+}
+
+static int
+nfp_abm_ctrl_snap_read(struct nfp_abm_link *alink, u8 *buf,
+		       const struct nfp_rtsym *sym, unsigned int stride,
+		       unsigned int area_off, unsigned int band)
+{
+	struct nfp_cpp *cpp = alink->abm->app->cpp;
+	unsigned int qid;
+	size_t len;
+	int ret;
+
+	qid = band * NFP_NET_MAX_RX_RINGS + alink->queue_base;
+	len = alink->total_queues * stride;
+
+	ret = __nfp_rtsym_read(cpp, sym, 3, 0, qid * stride,
+			       nfp_abm_ctrl_snap_area(alink, buf, stride,
+						      area_off, band), len);
+	if (ret != len) {
+		nfp_err(cpp, "RED offload reading stats failed on vNIC %d band %d (+ %d): %d\n",
+			alink->id, band, alink->queue_base, ret);
+		return ret < 0 ? ret : -EIO;
+	}
+
+	return 0;
+}
+
+/* Without per-band stats basic queue stats live in the vNIC BAR */
+static void nfp_abm_ctrl_snap_read_basic(struct nfp_abm_link *alink, u8 *buf)
+{
+	const unsigned int q_off = NFP_QMSTAT_STRIDE + NFP_QLVL_STRIDE;
+	unsigned int queue, id;
+	__le64 *p;
+
+	for (queue = 0; queue < alink->total_queues; queue++) {
+		id = alink->queue_base + queue;
+		p = (__le64 *)(nfp_abm_ctrl_snap_area(alink, buf,
+						      NFP_Q_STAT_STRIDE,
+						      q_off, 0) +
+			       queue * NFP_Q_STAT_STRIDE);
+
+		p[NFP_Q_STAT_PKTS / 8] =
+			cpu_to_le64(nn_readq(alink->vnic,
+					     NFP_NET_CFG_RXR_STATS(id) +
+					     NFP_Q_STAT_PKTS));
+		p[NFP_Q_STAT_BYTES / 8] =
+			cpu_to_le64(nn_readq(alink->vnic,
+					     NFP_NET_CFG_RXR_STATS(id) +
+					     NFP_Q_STAT_BYTES));
+	}
+}
+
+/**
+ * nfp_abm_ctrl_read_stats_snap() - read queue stats of a link in bulk
+ * @alink:	ABM link
+ * @buf:	zeroed buffer of nfp_abm_ctrl_stats_snap_size() bytes
+ *
+ * Read all stats of the link's queues with a few contiguous transfers per
+ * band, rather than one CPP read per counter.  Use nfp_abm_ctrl_parse_*()
+ * to extract the values.
+ *
+ * Return: 0 or -ERRNO
+ */
+int nfp_abm_ctrl_read_stats_snap(struct nfp_abm_link *alink, u8 *buf)
+{
+	struct nfp_abm *abm = alink->abm;
+	unsigned int band;
+	int err;
+
+	for (band = 0; band < abm->num_bands; band++) {
+		err = nfp_abm_ctrl_snap_read(alink, buf, abm->qm_stats,
+					     NFP_QMSTAT_STRIDE, 0, band);
+		if (err)
+			return err;
+
+		err = nfp_abm_ctrl_snap_read(alink, buf, abm->q_lvls,
+					     NFP_QLVL_STRIDE,
+					     NFP_QMSTAT_STRIDE, band);
+		if (err)
+			return err;
+
+		if (!nfp_abm_has_prio(abm))
+			continue;
+
+		err = nfp_abm_ctrl_snap_read(alink, buf, abm->q_stats,
+					     NFP_Q_STAT_STRIDE,
+					     NFP_QMSTAT_STRIDE + NFP_QLVL_STRIDE,
+					     band);
+		if (err)
+			return err;
+	}
+
+	if (!nfp_abm_has_prio(abm))
+		nfp_abm_ctrl_snap_read_basic(alink, buf);
+
+	return 0;
+}
+
+static u64
+nfp_abm_ctrl_snap_stat(struct nfp_abm_link *alink, const u8 *buf,
+		       unsigned int stride, unsigned int area_off,
+		       unsigned int offset, unsigned int band,
+		       unsigned int queue, bool is_u64)
+{
+	u8 *p;
+
+	p = nfp_abm_ctrl_snap_area(alink, buf, stride, area_off, band) +
+	    queue * stride + offset;
+
+	/* Strides keep all stats naturally aligned within the buffer */
+	return is_u64 ? le64_to_cpup((__le64 *)p) : le32_to_cpup((__le32 *)p);
+}
+
+void nfp_abm_ctrl_parse_q_stats(struct nfp_abm_link *alink, const u8 *buf,
+				unsigned int band, unsigned int queue,
+				struct nfp_alink_stats *stats)
+{
+	const unsigned int q_off = NFP_QMSTAT_STRIDE + NFP_QLVL_STRIDE;
+
+	stats->tx_pkts =
+		nfp_abm_ctrl_snap_stat(alink, buf, NFP_Q_STAT_STRIDE, q_off,
+				       NFP_Q_STAT_PKTS, band, queue, true);
+	stats->tx_bytes =
+		nfp_abm_ctrl_snap_stat(alink, buf, NFP_Q_STAT_STRIDE, q_off,
+				       NFP_Q_STAT_BYTES, band, queue, true);
+	stats->backlog_bytes =
+		nfp_abm_ctrl_snap_stat(alink, buf, NFP_QLVL_STRIDE,
+				       NFP_QMSTAT_STRIDE, NFP_QLVL_BLOG_BYTES,
+				       band, queue, false);
+	stats->backlog_pkts =
+		nfp_abm_ctrl_snap_stat(alink, buf, NFP_QLVL_STRIDE,
+				       NFP_QMSTAT_STRIDE, NFP_QLVL_BLOG_PKTS,
+				       band, queue, false);
+	stats->drops =
+		nfp_abm_ctrl_snap_stat(alink, buf, NFP_QMSTAT_STRIDE, 0,
+				       NFP_QMSTAT_DROP, band, queue, true);
+	stats->overlimits =
+		nfp_abm_ctrl_snap_stat(alink, buf, NFP_QMSTAT_STRIDE, 0,
+				       NFP_QMSTAT_ECN, band, queue, true);
+}
+
+void nfp_abm_ctrl_parse_q_xstats(struct nfp_abm_link *alink, const u8 *buf,
+				 unsigned int band, unsigned int queue,
+				 struct nfp_alink_xstats *xstats)
+{
+	xstats->pdrop =
+		nfp_abm_ctrl_snap_stat(alink, buf, NFP_QMSTAT_STRIDE, 0,
+				       NFP_QMSTAT_DROP, band, queue, true);
+	xstats->ecn_marked =
+		nfp_abm_ctrl_snap_stat(alink, buf, NFP_QMSTAT_STRIDE, 0,
+				       NFP_QMSTAT_ECN, band, queue, true);
+}
+
 int nfp_abm_ctrl_qm_enable(struct nfp_abm *abm)
 {
 	return nfp_mbox_cmd(abm->app->pf, NFP_MBOX_PCIE_ABM_ENABLE,
@@ -348,6 +348,7 @@ nfp_abm_vnic_alloc(struct nfp_app *app, struct nfp_net *nn, unsigned int id)
 
 	nfp_abm_vnic_set_mac(app->pf, abm, nn, id);
 	INIT_RADIX_TREE(&alink->qdiscs, GFP_KERNEL);
+	nfp_abm_stats_poll_init(alink);
 
 	return 0;
 
@@ -364,6 +365,7 @@ static void nfp_abm_vnic_free(struct nfp_app *app, struct nfp_net *nn)
 
 	nfp_abm_kill_reprs(alink->abm, alink);
 	WARN(!radix_tree_empty(&alink->qdiscs), "left over qdiscs\n");
+	nfp_abm_stats_poll_clean(alink);
 	kfree(alink->prio_map);
 	kfree(alink);
 }
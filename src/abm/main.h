@@ -7,6 +7,8 @@
 #include <linux/bits.h>
 #include <linux/list.h>
 #include <linux/radix-tree.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
 #include <net/devlink.h>
 #include <net/pkt_cls.h>
 #include <net/pkt_sched.h>
@@ -112,6 +114,18 @@ struct nfp_alink_xstats {
 	u64 pdrop;
 };
 
+/**
+ * struct nfp_abm_stats_snap - immutable snapshot of link queue stats
+ * @rcu:	RCU head for freeing
+ * @time:	ktime when the snapshot was taken
+ * @data:	raw stats, see nfp_abm_ctrl_read_stats_snap()
+ */
+struct nfp_abm_stats_snap {
+	struct rcu_head rcu;
+	u64 time;
+	u8 data[] __aligned(8);
+};
+
 enum nfp_qdisc_type {
 	NFP_QDISC_NONE = 0,
 	NFP_QDISC_MQ,
@@ -192,7 +206,11 @@ struct nfp_qdisc {
  * @queue_base:	id of base to host queue within PCIe (not QC idx)
  * @total_queues:	number of PF queues
  *
- * @last_stats_update:	ktime of last stats update
+ * @last_stats_update:	ktime of the stats snapshot last parsed into qdiscs
+ * @stats_snap:		latest snapshot of the link's queue stats (RCU)
+ * @stats_snap_lock:	serializes publishing of @stats_snap
+ * @stats_poll:		periodic refresh of @stats_snap
+ * @stats_last_use:	jiffies of the last stats request from tc
  *
  * @prio_map:		current map of priorities
  * @has_prio:		@prio_map is valid
@@ -211,6 +229,10 @@ struct nfp_abm_link {
 	unsigned int total_queues;
 
 	u64 last_stats_update;
+	struct nfp_abm_stats_snap __rcu *stats_snap;
+	spinlock_t stats_snap_lock;
+	struct delayed_work stats_poll;
+	unsigned long stats_last_use;
 
 	u32 *prio_map;
 	bool has_prio;
@@ -238,6 +260,8 @@ static inline bool nfp_abm_has_mark(struct nfp_abm *abm)
 }
 
 void nfp_abm_qdisc_offload_update(struct nfp_abm_link *alink);
+void nfp_abm_stats_poll_init(struct nfp_abm_link *alink);
+void nfp_abm_stats_poll_clean(struct nfp_abm_link *alink);
 int nfp_abm_setup_root(struct net_device *netdev, struct nfp_abm_link *alink,
 		       struct tc_root_qopt_offload *opt);
 int nfp_abm_setup_tc_red(struct net_device *netdev, struct nfp_abm_link *alink,
@@ -264,6 +288,14 @@ int nfp_abm_ctrl_read_q_stats(struct nfp_abm_link *alink,
 int nfp_abm_ctrl_read_q_xstats(struct nfp_abm_link *alink,
 			       unsigned int band, unsigned int queue,
 			       struct nfp_alink_xstats *xstats);
+size_t nfp_abm_ctrl_stats_snap_size(struct nfp_abm_link *alink);
+int nfp_abm_ctrl_read_stats_snap(struct nfp_abm_link *alink, u8 *buf);
+void nfp_abm_ctrl_parse_q_stats(struct nfp_abm_link *alink, const u8 *buf,
+				unsigned int band, unsigned int queue,
+				struct nfp_alink_stats *stats);
+void nfp_abm_ctrl_parse_q_xstats(struct nfp_abm_link *alink, const u8 *buf,
+				 unsigned int band, unsigned int queue,
+				 struct nfp_alink_xstats *xstats);
 u64 nfp_abm_ctrl_stat_non_sto(struct nfp_abm_link *alink, unsigned int i);
 u64 nfp_abm_ctrl_stat_sto(struct nfp_abm_link *alink, unsigned int i);
 int nfp_abm_ctrl_qm_enable(struct nfp_abm *abm);
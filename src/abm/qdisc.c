@@ -1,7 +1,9 @@
 // SPDX-License-Identifier: (GPL-2.0-only OR BSD-2-Clause)
 /* Copyright (C) 2018 Netronome Systems, Inc. */
 
+#include <linux/module.h>
 #include <linux/rtnetlink.h>
+#include <linux/slab.h>
 #include <net/pkt_cls.h>
 #include <net/pkt_sched.h>
 #include <net/red.h>
@@ -41,34 +43,33 @@ nfp_abm_stats_propagate(struct nfp_alink_stats *parent,
 	parent->drops		+= child->drops;
 }
 
+static unsigned int abm_stats_poll_ms = 100;
+module_param(abm_stats_poll_ms, uint, 0644);
+MODULE_PARM_DESC(abm_stats_poll_ms, "ABM qdisc stats refresh interval in ms, 0 to read stats from the device on qdisc dumps (default = 100)");
+
+/* Stop polling after this many intervals without anyone reading stats */
+#define NFP_ABM_STATS_POLL_IDLE		10
+
 static void
 nfp_abm_stats_update_red(struct nfp_abm_link *alink, struct nfp_qdisc *qdisc,
-			 unsigned int queue)
+			 const u8 *buf, unsigned int queue)
 {
-	struct nfp_cpp *cpp = alink->abm->app->cpp;
 	unsigned int i;
-	int err;
 
 	if (!qdisc->offloaded)
 		return;
 
 	for (i = 0; i < qdisc->red.num_bands; i++) {
-		err = nfp_abm_ctrl_read_q_stats(alink, i, queue,
-						&qdisc->red.band[i].stats);
-		if (err)
-			nfp_err(cpp, "RED stats (%d, %d) read failed with error %d\n",
-				i, queue, err);
-
-		err = nfp_abm_ctrl_read_q_xstats(alink, i, queue,
-						 &qdisc->red.band[i].xstats);
-		if (err)
-			nfp_err(cpp, "RED xstats (%d, %d) read failed with error %d\n",
-				i, queue, err);
+		nfp_abm_ctrl_parse_q_stats(alink, buf, i, queue,
+					   &qdisc->red.band[i].stats);
+		nfp_abm_ctrl_parse_q_xstats(alink, buf, i, queue,
+					    &qdisc->red.band[i].xstats);
 	}
 }
 
 static void
-nfp_abm_stats_update_mq(struct nfp_abm_link *alink, struct nfp_qdisc *qdisc)
+nfp_abm_stats_update_mq(struct nfp_abm_link *alink, struct nfp_qdisc *qdisc,
+			const u8 *buf)
 {
 	unsigned int i;
 
@@ -77,29 +78,148 @@ nfp_abm_stats_update_mq(struct nfp_abm_link *alink, struct nfp_qdisc *qdisc)
 
 	for (i = 0; i < alink->total_queues; i++)
 		if (nfp_abm_qdisc_child_valid(qdisc, i))
-			nfp_abm_stats_update_red(alink, qdisc->children[i], i);
+			nfp_abm_stats_update_red(alink, qdisc->children[i],
+						 buf, i);
 }
 
-static void __nfp_abm_stats_update(struct nfp_abm_link *alink, u64 time_now)
+#ifdef COMPAT__HAVE_KVFREE_RCU
+#define nfp_abm_stats_snap_zalloc	kvzalloc
+#define nfp_abm_stats_snap_free(snap)	kvfree_rcu(snap, rcu)
+#else
+#define nfp_abm_stats_snap_zalloc	kzalloc
+#define nfp_abm_stats_snap_free(snap)	kfree_rcu(snap, rcu)
+#endif
+
+/* Read all queues of the link at once and publish the result */
+static int nfp_abm_stats_snap_refresh(struct nfp_abm_link *alink)
 {
-	alink->last_stats_update = time_now;
-	if (alink->root_qdisc)
-		nfp_abm_stats_update_mq(alink, alink->root_qdisc);
+	struct nfp_abm_stats_snap *snap, *old;
+	size_t size;
+	int err;
+
+	size = struct_size(snap, data, nfp_abm_ctrl_stats_snap_size(alink));
+	snap = nfp_abm_stats_snap_zalloc(size, GFP_KERNEL);
+	if (!snap)
+		return -ENOMEM;
+
+	/* Order snapshots by the start of the read, a read which started
+	 * earlier must never replace one which started later.
+	 */
+	snap->time = ktime_get();
+	err = nfp_abm_ctrl_read_stats_snap(alink, snap->data);
+	if (err) {
+		kvfree(snap);
+		return err;
+	}
+
+	spin_lock(&alink->stats_snap_lock);
+	old = rcu_dereference_protected(alink->stats_snap,
+					lockdep_is_held(&alink->stats_snap_lock));
+	/* Lost the race against a newer refresh */
+	if (old && old->time > snap->time) {
+		spin_unlock(&alink->stats_snap_lock);
+		kvfree(snap);
+		return 0;
+	}
+	rcu_assign_pointer(alink->stats_snap, snap);
+	spin_unlock(&alink->stats_snap_lock);
+
+	if (old)
+		nfp_abm_stats_snap_free(old);
+	return 0;
 }
 
-static void nfp_abm_stats_update(struct nfp_abm_link *alink)
+static void nfp_abm_stats_poll(struct work_struct *work)
 {
-	u64 now;
+	struct nfp_abm_link *alink;
+	unsigned long ival;
+	int err;
+
+	alink = container_of(to_delayed_work(work), struct nfp_abm_link,
+			     stats_poll);
 
+	ival = msecs_to_jiffies(READ_ONCE(abm_stats_poll_ms));
+	if (!ival ||
+	    time_after(jiffies, READ_ONCE(alink->stats_last_use) +
+				NFP_ABM_STATS_POLL_IDLE * ival))
+		return;
+
+	err = nfp_abm_stats_snap_refresh(alink);
+	if (err)
+		nfp_err(alink->abm->app->cpp,
+			"RED stats read failed with error %d\n", err);
+
+	schedule_delayed_work(&alink->stats_poll, ival);
+}
+
+static void __nfp_abm_stats_update(struct nfp_abm_link *alink, bool sync)
+{
+	struct nfp_abm_stats_snap *snap;
+	unsigned int poll_ms;
+	u64 max_age;
+	int err;
+
+	poll_ms = READ_ONCE(abm_stats_poll_ms);
 	/* Limit the frequency of updates - stats of non-leaf qdiscs are a sum
 	 * of all their leafs, so we would read the same stat multiple times
-	 * for every dump.
+	 * for every dump.  With polling enabled the poller keeps the snapshot
+	 * fresh, only read from the device if it went idle.
 	 */
-	now = ktime_get();
-	if (now - alink->last_stats_update < NFP_ABM_STATS_REFRESH_IVAL)
-		return;
+	max_age = poll_ms ? 2ULL * poll_ms * NSEC_PER_MSEC :
+			    NFP_ABM_STATS_REFRESH_IVAL;
+
+	rcu_read_lock();
+	snap = rcu_dereference(alink->stats_snap);
+	if (!snap || ktime_get() - snap->time >= max_age)
+		sync = true;
+	rcu_read_unlock();
+
+	if (sync) {
+		err = nfp_abm_stats_snap_refresh(alink);
+		if (err)
+			nfp_err(alink->abm->app->cpp,
+				"RED stats read failed with error %d\n", err);
+	}
+
+	if (poll_ms) {
+		WRITE_ONCE(alink->stats_last_use, jiffies);
+		if (!delayed_work_pending(&alink->stats_poll))
+			schedule_delayed_work(&alink->stats_poll,
+					      msecs_to_jiffies(poll_ms));
+	}
+
+	rcu_read_lock();
+	snap = rcu_dereference(alink->stats_snap);
+	if (snap && snap->time != alink->last_stats_update) {
+		alink->last_stats_update = snap->time;
+		if (alink->root_qdisc)
+			nfp_abm_stats_update_mq(alink, alink->root_qdisc,
+						snap->data);
+	}
+	rcu_read_unlock();
+}
+
+static void nfp_abm_stats_update(struct nfp_abm_link *alink)
+{
+	__nfp_abm_stats_update(alink, false);
+}
+
+void nfp_abm_stats_poll_init(struct nfp_abm_link *alink)
+{
+	spin_lock_init(&alink->stats_snap_lock);
+	INIT_DELAYED_WORK(&alink->stats_poll, nfp_abm_stats_poll);
+}
+
+void nfp_abm_stats_poll_clean(struct nfp_abm_link *alink)
+{
+	struct nfp_abm_stats_snap *snap;
+
+	cancel_delayed_work_sync(&alink->stats_poll);
 
-	__nfp_abm_stats_update(alink, now);
+	snap = rcu_dereference_protected(alink->stats_snap, true);
+	RCU_INIT_POINTER(alink->stats_snap, NULL);
+	if (snap)
+		nfp_abm_stats_snap_free(snap);
 }
 
 static void
@@ -278,7 +398,7 @@ void nfp_abm_qdisc_offload_update(struct nfp_abm_link *alink)
 		if (test_bit(i, abm->threshold_undef))
 			__nfp_abm_ctrl_set_q_lvl(abm, i, NFP_ABM_LVL_INFINITY);
 
-	__nfp_abm_stats_update(alink, ktime_get());
+	__nfp_abm_stats_update(alink, true);
 }
 
 static void
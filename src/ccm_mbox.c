@@ -402,6 +402,9 @@ static void nfp_ccm_mbox_run_queue_unlock(struct nfp_net *nn)
 	}
 	spin_unlock_bh(&nn->mbox_cmsg.queue.lock);
 
+	atomic64_inc(&nn->mbox_cmsg.batches);
+	atomic64_add(cnt, &nn->mbox_cmsg.batch_msgs);
+
 	/* Now we own all skb's marked in progress, new requests may arrive
 	 * at the end of the queue.
 	 */
@@ -669,6 +672,8 @@ int nfp_ccm_mbox_post(struct nfp_net *nn, struct sk_buff *skb,
 
 	if (nfp_ccm_mbox_is_first(nn, skb)) {
 		if (nn_ctrl_bar_trylock(nn)) {
+			atomic64_inc(&nn->mbox_cmsg.batches);
+			atomic64_inc(&nn->mbox_cmsg.batch_msgs);
 			nfp_ccm_mbox_copy_in(nn, skb);
 			nfp_net_mbox_reconfig_post(nn,
 						   NFP_NET_CFG_MBOX_CMD_TLV_CMSG);
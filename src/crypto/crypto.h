@@ -21,6 +21,7 @@ struct nfp_net_tls_offload_ctx {
 
 #ifdef COMPAT__HAVE_TLS_OFFLOAD
 int nfp_net_tls_init(struct nfp_net *nn);
+void nfp_net_tls_clean(struct nfp_net *nn);
 int nfp_net_tls_rx_resync_req(struct net_device *netdev,
 			      struct nfp_net_tls_resync_req *req,
 			      void *pkt, unsigned int pkt_len);
@@ -30,6 +31,10 @@ static inline int nfp_net_tls_init(struct nfp_net *nn)
 	return 0;
 }
 
+static inline void nfp_net_tls_clean(struct nfp_net *nn)
+{
+}
+
 static inline int
 nfp_net_tls_rx_resync_req(struct net_device *netdev,
 			  struct nfp_net_tls_resync_req *req,
@@ -22,6 +22,7 @@
 #include "crypto.h"
 
 #define NFP_NET_IPSEC_MAX_SA_CNT  (16 * 1024) /* Firmware support a maximum of 16K SA offload */
+#define NFP_NET_IPSEC_CFG_BATCH	  64 /* SA messages sent per mailbox lock hold */
 
 /* IPsec config message cmd codes */
 enum nfp_ipsec_cfg_mssg_cmd_codes {
@@ -136,31 +137,33 @@ struct nfp_ipsec_cfg_mssg {
 	};
 };
 
-static int nfp_net_ipsec_cfg(struct nfp_net *nn, struct nfp_mbox_amsg_entry *entry)
+struct nfp_ipsec_cfg_entry {
+	struct list_head list;
+	struct nfp_ipsec_cfg_mssg msg;
+};
+
+/* Must be called with the mailbox locked */
+static int nfp_net_ipsec_cfg(struct nfp_net *nn, struct nfp_ipsec_cfg_mssg *msg)
 {
 	unsigned int offset = nn->tlv_caps.mbox_off + NFP_NET_CFG_MBOX_SIMPLE_VAL;
-	struct nfp_ipsec_cfg_mssg *msg = (struct nfp_ipsec_cfg_mssg *)entry->msg;
-	int i, msg_size, ret;
+	int ret;
 
-	ret = nfp_net_mbox_lock(nn, sizeof(*msg));
-	if (ret)
-		return ret;
+#ifdef __LITTLE_ENDIAN
+	__iowrite32_copy(nn->dp.ctrl_bar + offset, msg->raw,
+			 ARRAY_SIZE(msg->raw));
+#else
+	int i;
 
-	msg_size = ARRAY_SIZE(msg->raw);
-	for (i = 0; i < msg_size; i++)
+	for (i = 0; i < ARRAY_SIZE(msg->raw); i++)
 		nn_writel(nn, offset + 4 * i, msg->raw[i]);
+#endif
 
-	ret = nfp_net_mbox_reconfig(nn, entry->cmd);
-	if (ret < 0) {
-		nn_ctrl_bar_unlock(nn);
+	ret = nfp_net_mbox_reconfig(nn, NFP_NET_CFG_MBOX_CMD_IPSEC);
+	if (ret < 0)
 		return ret;
-	}
-
-	/* For now we always read the whole message response back */
-	for (i = 0; i < msg_size; i++)
-		msg->raw[i] = nn_readl(nn, offset + 4 * i);
 
-	nn_ctrl_bar_unlock(nn);
+	/* Only the response code in the first word is of interest */
+	msg->raw[0] = nn_readl(nn, offset);
 
 	switch (msg->rsp) {
 	case NFP_IPSEC_CFG_MSSG_OK:
@@ -178,6 +181,87 @@ static int nfp_net_ipsec_cfg(struct nfp_net *nn, struct nfp_mbox_amsg_entry *ent
 	}
 }
 
+static void
+nfp_net_ipsec_cfg_done(struct nfp_net *nn, struct nfp_ipsec_cfg_mssg *msg,
+		       int err)
+{
+	if (msg->cmd == NFP_IPSEC_CFG_MSSG_ADD_SA)
+		atomic_inc(err ? &nn->ipsec_sa_add_fail : &nn->ipsec_sa_add);
+	else if (!err)
+		atomic_inc(&nn->ipsec_sa_del);
+
+	if (err)
+		nn_err(nn, "IPsec cmd %d for SA %d failed %d.\n",
+		       msg->cmd, msg->sa_idx, err);
+}
+
+/* Send all queued SA messages, re-taking the mailbox lock every
+ * NFP_NET_IPSEC_CFG_BATCH messages so other users are not starved
+ * during rekey storms.
+ */
+static void nfp_net_ipsec_cfg_work(struct work_struct *work)
+{
+	struct nfp_net *nn = container_of(work, struct nfp_net, ipsec_cfg.work);
+	struct nfp_ipsec_cfg_entry *entry, *tmp;
+	unsigned int batched = 0;
+	LIST_HEAD(list);
+	int err;
+
+	spin_lock_bh(&nn->ipsec_cfg.lock);
+	list_splice_init(&nn->ipsec_cfg.list, &list);
+	spin_unlock_bh(&nn->ipsec_cfg.lock);
+
+	if (list_empty(&list))
+		return;
+
+	err = nfp_net_mbox_lock(nn, sizeof(entry->msg));
+	if (!err)
+		atomic_inc(&nn->ipsec_cfg_batch);
+
+	list_for_each_entry_safe(entry, tmp, &list, list) {
+		if (!err) {
+			if (batched++ == NFP_NET_IPSEC_CFG_BATCH) {
+				nn_ctrl_bar_unlock(nn);
+				cond_resched();
+				nn_ctrl_bar_lock(nn);
+				atomic_inc(&nn->ipsec_cfg_batch);
+				batched = 1;
+			}
+			nfp_net_ipsec_cfg_done(nn, &entry->msg,
+					       nfp_net_ipsec_cfg(nn, &entry->msg));
+		} else {
+			nfp_net_ipsec_cfg_done(nn, &entry->msg, err);
+		}
+
+		list_del(&entry->list);
+		kfree(entry);
+	}
+
+	if (!err)
+		nn_ctrl_bar_unlock(nn);
+}
+
+static int
+nfp_net_ipsec_cfg_queue(struct nfp_net *nn, struct nfp_ipsec_cfg_mssg *msg)
+{
+	struct nfp_ipsec_cfg_entry *entry;
+
+	/* SA deletes may come from atomic context */
+	entry = kmalloc(sizeof(*entry), GFP_ATOMIC);
+	if (!entry)
+		return -ENOMEM;
+
+	entry->msg = *msg;
+
+	spin_lock_bh(&nn->ipsec_cfg.lock);
+	list_add_tail(&entry->list, &nn->ipsec_cfg.list);
+	spin_unlock_bh(&nn->ipsec_cfg.lock);
+
+	queue_work(nn->mbox_amsg.wq, &nn->ipsec_cfg.work);
+
+	return 0;
+}
+
 static int set_aes_keylen(struct nfp_ipsec_cfg_add_sa *cfg, int alg, int keylen)
 {
 	bool aes_gmac = (alg == SADB_X_EALG_NULL_AES_GMAC);
@@ -545,8 +629,7 @@ int nfp_net_xfrm_add_state(struct net_device *dev,
 	/* Allocate saidx and commit the SA */
 	msg.cmd = NFP_IPSEC_CFG_MSSG_ADD_SA;
 	msg.sa_idx = saidx;
-	err = nfp_net_sched_mbox_amsg_work(nn, NFP_NET_CFG_MBOX_CMD_IPSEC, &msg,
-					   sizeof(msg), nfp_net_ipsec_cfg);
+	err = nfp_net_ipsec_cfg_queue(nn, &msg);
 	if (err) {
 		xa_erase(&nn->xa_ipsec, saidx);
 		NL_SET_ERR_MSG_MOD(extack, "Failed to issue IPsec command");
@@ -578,8 +661,7 @@ static void nfp_net_xfrm_del_state(struct net_device *dev, struct xfrm_state *x)
 	int err;
 
 	nn = netdev_priv(dev);
-	err = nfp_net_sched_mbox_amsg_work(nn, NFP_NET_CFG_MBOX_CMD_IPSEC, &msg,
-					   sizeof(msg), nfp_net_ipsec_cfg);
+	err = nfp_net_ipsec_cfg_queue(nn, &msg);
 	if (err)
 		nn_warn(nn, "Failed to invalidate SA in hardware\n");
 
@@ -613,6 +695,9 @@ void nfp_net_ipsec_init(struct nfp_net *nn)
 		return;
 
 	xa_init_flags(&nn->xa_ipsec, XA_FLAGS_ALLOC);
+	spin_lock_init(&nn->ipsec_cfg.lock);
+	INIT_LIST_HEAD(&nn->ipsec_cfg.list);
+	INIT_WORK(&nn->ipsec_cfg.work, nfp_net_ipsec_cfg_work);
 	nn->dp.netdev->xfrmdev_ops = &nfp_net_ipsec_xfrmdev_ops;
 }
 
@@ -621,6 +706,7 @@ void nfp_net_ipsec_clean(struct nfp_net *nn)
 	if (!(nn->cap_w1 & NFP_NET_CFG_CTRL_IPSEC))
 		return;
 
+	flush_work(&nn->ipsec_cfg.work);
 	WARN_ON(!xa_empty(&nn->xa_ipsec));
 	xa_destroy(&nn->xa_ipsec);
 }
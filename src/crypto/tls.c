@@ -14,6 +14,11 @@
 #include "crypto.h"
 #include "fw.h"
 
+/* Connection deletes are collected for this long and then posted to the
+ * mailbox together, so they share mailbox batches.
+ */
+#define NFP_NET_TLS_DEL_DELAY		msecs_to_jiffies(2)
+
 #define NFP_NET_TLS_CCM_MBOX_OPS_MASK		\
 	(BIT(NFP_CCM_TYPE_CRYPTO_RESET) |	\
 	 BIT(NFP_CCM_TYPE_CRYPTO_ADD) |		\
@@ -150,6 +155,55 @@ static void nfp_net_tls_del_fw(struct nfp_net *nn, __be32 *fw_handle)
 				       NFP_CCM_TYPE_CRYPTO_DEL);
 }
 
+struct nfp_net_tls_del_entry {
+	struct list_head list;
+	__be32 fw_handle[2];
+};
+
+static int nfp_net_tls_post_del(struct nfp_net *nn, __be32 *fw_handle)
+{
+	struct nfp_crypto_req_del *req;
+	struct sk_buff *skb;
+
+	skb = nfp_net_tls_alloc_simple(nn, sizeof(*req), GFP_KERNEL);
+	if (!skb)
+		return -ENOMEM;
+
+	req = (void *)skb->data;
+	req->ep_id = 0;
+	memcpy(req->handle, fw_handle, sizeof(req->handle));
+
+	return nfp_ccm_mbox_post(nn, skb, NFP_CCM_TYPE_CRYPTO_DEL,
+				 sizeof(struct nfp_crypto_reply_simple));
+}
+
+static void nfp_net_tls_del_work(struct work_struct *work)
+{
+	struct nfp_net_tls_del_entry *entry, *tmp;
+	struct nfp_net *nn;
+	LIST_HEAD(list);
+
+	nn = container_of(to_delayed_work(work), struct nfp_net, ktls_del.work);
+
+	spin_lock_bh(&nn->ktls_del.lock);
+	list_splice_init(&nn->ktls_del.list, &list);
+	spin_unlock_bh(&nn->ktls_del.lock);
+
+	/* Posted messages queue up behind each other in the CCM mailbox and
+	 * go out in as few batches as fit. Fall back to a waiting, critical
+	 * delete if the mailbox queue is full.
+	 */
+	list_for_each_entry_safe(entry, tmp, &list, list) {
+		if (nfp_net_tls_post_del(nn, entry->fw_handle))
+			nfp_net_tls_del_fw(nn, entry->fw_handle);
+		else
+			atomic_inc(&nn->ktls_del_deferred);
+
+		list_del(&entry->list);
+		kfree(entry);
+	}
+}
+
 static void
 nfp_net_tls_set_ipver_vlan(struct nfp_crypto_req_add_front *front, u8 ipver)
 {
@@ -274,6 +328,7 @@ nfp_net_tls_add(struct net_device *netdev, struct sock *sk,
 	struct nfp_crypto_req_add_back *back;
 	struct nfp_crypto_reply_add *reply;
 	struct sk_buff *skb;
+	ktime_t start;
 	size_t req_sz;
 	void *req;
 	bool ipv6;
@@ -306,6 +361,8 @@ nfp_net_tls_add(struct net_device *netdev, struct sock *sk,
 		return -EOPNOTSUPP;
 	}
 
+	start = ktime_get();
+
 	err = nfp_net_tls_conn_add(nn, direction);
 	if (err)
 		return err;
@@ -390,6 +447,10 @@ nfp_net_tls_add(struct net_device *netdev, struct sock *sk,
 		ntls->next_seq = start_offload_tcp_sn;
 	dev_consume_skb_any(skb);
 
+	atomic_inc(&nn->ktls_add_cnt);
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start)),
+		     &nn->ktls_add_time_ns);
+
 	if (direction == TLS_OFFLOAD_CTX_DIR_TX)
 		return 0;
 
@@ -413,11 +474,26 @@ nfp_net_tls_del(struct net_device *netdev, struct tls_context *tls_ctx,
 {
 	struct nfp_net *nn = netdev_priv(netdev);
 	struct nfp_net_tls_offload_ctx *ntls;
+	struct nfp_net_tls_del_entry *entry;
 
 	nfp_net_tls_conn_remove(nn, direction);
 
 	ntls = __tls_driver_ctx(tls_ctx, direction);
-	nfp_net_tls_del_fw(nn, ntls->fw_handle);
+
+	entry = kmalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry) {
+		nfp_net_tls_del_fw(nn, ntls->fw_handle);
+		return;
+	}
+	memcpy(entry->fw_handle, ntls->fw_handle, sizeof(entry->fw_handle));
+
+	spin_lock_bh(&nn->ktls_del.lock);
+	list_add_tail(&entry->list, &nn->ktls_del.list);
+	spin_unlock_bh(&nn->ktls_del.lock);
+
+	/* Already pending work keeps its timer, coalescing the deletes */
+	queue_delayed_work(nn->mbox_cmsg.workq, &nn->ktls_del.work,
+			   NFP_NET_TLS_DEL_DELAY);
 }
 
 static int
@@ -572,6 +648,10 @@ int nfp_net_tls_init(struct nfp_net *nn)
 	struct net_device *netdev = nn->dp.netdev;
 	int err;
 
+	spin_lock_init(&nn->ktls_del.lock);
+	INIT_LIST_HEAD(&nn->ktls_del.list);
+	INIT_DELAYED_WORK(&nn->ktls_del.work, nfp_net_tls_del_work);
+
 	if (!(nn->tlv_caps.crypto_ops & NFP_NET_TLS_OPCODE_MASK))
 		return 0;
 
@@ -609,3 +689,8 @@ int nfp_net_tls_init(struct nfp_net *nn)
 
 	return 0;
 }
+
+void nfp_net_tls_clean(struct nfp_net *nn)
+{
+	flush_delayed_work(&nn->ktls_del.work);
+}
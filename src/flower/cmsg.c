@@ -310,42 +310,70 @@ void nfp_flower_cmsg_process_rx(struct work_struct *work)
 {
 	struct sk_buff_head cmsg_joined;
 	struct nfp_flower_priv *priv;
+	struct nfp_fl_cmsg_rxq *rxq;
 	struct sk_buff *skb;
 
-	priv = container_of(work, struct nfp_flower_priv, cmsg_work);
+	rxq = container_of(work, struct nfp_fl_cmsg_rxq, work);
+	priv = rxq->priv;
 	skb_queue_head_init(&cmsg_joined);
 
-	spin_lock_bh(&priv->cmsg_skbs_high.lock);
-	skb_queue_splice_tail_init(&priv->cmsg_skbs_high, &cmsg_joined);
-	spin_unlock_bh(&priv->cmsg_skbs_high.lock);
+	spin_lock_bh(&rxq->skbs.lock);
+	skb_queue_splice_tail_init(&rxq->skbs, &cmsg_joined);
+	spin_unlock_bh(&rxq->skbs.lock);
 
-	spin_lock_bh(&priv->cmsg_skbs_low.lock);
-	skb_queue_splice_tail_init(&priv->cmsg_skbs_low, &cmsg_joined);
-	spin_unlock_bh(&priv->cmsg_skbs_low.lock);
-
-	while ((skb = __skb_dequeue(&cmsg_joined)))
+	while ((skb = __skb_dequeue(&cmsg_joined))) {
 		nfp_flower_cmsg_process_one_rx(priv->app, skb);
+		atomic64_inc(&rxq->processed);
+	}
+}
+
+static enum nfp_fl_cmsg_rxq_id nfp_flower_cmsg_rxq_select(int type)
+{
+	switch (type) {
+	case NFP_FLOWER_CMSG_TYPE_PORT_MOD:
+		return NFP_FL_CMSG_RXQ_PORT;
+	case NFP_FLOWER_CMSG_TYPE_NO_NEIGH:
+	case NFP_FLOWER_CMSG_TYPE_NO_NEIGH_V6:
+	case NFP_FLOWER_CMSG_TYPE_ACTIVE_TUNS:
+	case NFP_FLOWER_CMSG_TYPE_ACTIVE_TUNS_V6:
+		return NFP_FL_CMSG_RXQ_TUN;
+	case NFP_FLOWER_CMSG_TYPE_LAG_CONFIG:
+		return NFP_FL_CMSG_RXQ_LAG;
+	default:
+		return NFP_FL_CMSG_RXQ_MISC;
+	}
 }
 
 static void
 nfp_flower_queue_ctl_msg(struct nfp_app *app, struct sk_buff *skb, int type)
 {
 	struct nfp_flower_priv *priv = app->priv;
-	struct sk_buff_head *skb_head;
+	struct nfp_fl_cmsg_rxq *rxq;
+	unsigned int qlen;
 
-	if (type == NFP_FLOWER_CMSG_TYPE_PORT_MOD)
-		skb_head = &priv->cmsg_skbs_high;
-	else
-		skb_head = &priv->cmsg_skbs_low;
+	rxq = &priv->cmsg_rxq[nfp_flower_cmsg_rxq_select(type)];
 
-	if (skb_queue_len(skb_head) >= NFP_FLOWER_WORKQ_MAX_SKBS) {
+	spin_lock_bh(&rxq->skbs.lock);
+	qlen = skb_queue_len(&rxq->skbs);
+	if (qlen >= NFP_FLOWER_WORKQ_MAX_SKBS) {
+		spin_unlock_bh(&rxq->skbs.lock);
+		atomic64_inc(&rxq->dropped);
 		nfp_flower_cmsg_warn(app, "Dropping queued control messages\n");
 		dev_kfree_skb_any(skb);
 		return;
 	}
-
-	skb_queue_tail(skb_head, skb);
-	schedule_work(&priv->cmsg_work);
+	__skb_queue_tail(&rxq->skbs, skb);
+	if (qlen >= rxq->max_depth)
+		rxq->max_depth = qlen + 1;
+	spin_unlock_bh(&rxq->skbs.lock);
+
+	atomic64_inc(&rxq->queued);
+	/* Work already pending means the worker has not caught up with the
+	 * previous messages yet, count it so a building backlog is visible
+	 * long before messages start getting dropped.
+	 */
+	if (!queue_work(priv->cmsg_wq, &rxq->work))
+		atomic64_inc(&rxq->backlogged);
 }
 
 void nfp_flower_cmsg_rx(struct nfp_app *app, struct sk_buff *skb)
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: (GPL-2.0-only OR BSD-2-Clause)
 /* Copyright (C) 2021 Corigine, Inc. */
 
+#include <linux/bitfield.h>
 #include <linux/netfilter.h>
 #include <net/tc_act/tc_csum.h>
 #include <net/tc_act/tc_ct.h>
@@ -54,6 +55,48 @@ static void *get_hashentry(struct rhashtable *ht, void *key,
 	return result;
 }
 
+/* Merge candidates are indexed by the L3 and L4 protocol they match on,
+ * with 0 standing in for a wildcarded field. nft flows always match both
+ * exactly, so they only need to be checked against tc merges carrying the
+ * same protocols or a wildcard, instead of every tc merge in the zone.
+ *
+ * The index only prunes pairs the full merge check would reject, so it
+ * must be keyed on fields which are compared exactly and never rewritten:
+ *  - the zone needs no key, the index already is per zone;
+ *  - ct mark and labels are set by nft flow actions and matched by post_ct
+ *    flows under arbitrary masks, nfp_ct_check_meta() rejects those pairs
+ *    cheaply before the full check;
+ *  - L4 ports may be rewritten by NAT actions of the pre_ct and nft flows,
+ *    and nfp_ct_merge_check() skips or mangles them accordingly.
+ */
+#define NFP_FL_CT_IDX_N_PROTO		GENMASK(23, 8)
+#define NFP_FL_CT_IDX_IP_PROTO		GENMASK(7, 0)
+
+static u32 nfp_ct_merge_idx_key(__be16 n_proto, u8 ip_proto)
+{
+	/* ip_proto has no meaning without the L3 protocol */
+	if (!n_proto)
+		ip_proto = 0;
+
+	return FIELD_PREP(NFP_FL_CT_IDX_N_PROTO, be16_to_cpu(n_proto)) |
+	       FIELD_PREP(NFP_FL_CT_IDX_IP_PROTO, ip_proto);
+}
+
+static void nfp_ct_merge_idx_proto(struct flow_rule *rule, __be16 *n_proto,
+				   u8 *ip_proto)
+{
+	struct flow_match_basic match;
+
+	if (!flow_rule_match_key(rule, FLOW_DISSECTOR_KEY_BASIC))
+		return;
+
+	flow_rule_match_basic(rule, &match);
+	if (match.mask->n_proto == htons(0xffff))
+		*n_proto = match.key->n_proto;
+	if (match.mask->ip_proto == 0xff)
+		*ip_proto = match.key->ip_proto;
+}
+
 bool is_pre_ct_flow(struct flow_cls_offload *flow)
 {
 	struct flow_rule *rule = flow_cls_offload_flow_rule(flow);
@@ -1183,6 +1226,14 @@ static int nfp_ct_do_nft_merge(struct nfp_fl_ct_zone_entry *zt,
 
 	pre_ct_entry = tc_m_entry->pre_ct_parent;
 	post_ct_entry = tc_m_entry->post_ct_parent;
+	zt->priv->ct_merge_stats.nft_attempts++;
+
+	/* Do the cheap ct metadata check first, it rejects most of the
+	 * candidates when post_ct flows match on ct_mark or ct_label.
+	 */
+	err = nfp_ct_check_meta(post_ct_entry, nft_entry);
+	if (err)
+		return err;
 
 	err = nfp_ct_merge_act_check(pre_ct_entry, post_ct_entry, nft_entry);
 	if (err)
@@ -1198,9 +1249,6 @@ static int nfp_ct_do_nft_merge(struct nfp_fl_ct_zone_entry *zt,
 	if (err)
 		return err;
 	err = nfp_ct_merge_check(nft_entry, post_ct_entry);
-	if (err)
-		return err;
-	err = nfp_ct_check_meta(post_ct_entry, nft_entry);
 	if (err)
 		return err;
 
@@ -1246,6 +1294,7 @@ static int nfp_ct_do_nft_merge(struct nfp_fl_ct_zone_entry *zt,
 		goto err_nft_ct_merge_insert;
 
 	zt->nft_merge_count++;
+	zt->priv->ct_merge_stats.nft_merges++;
 
 	if (post_ct_entry->goto_chain_index > 0)
 		return nfp_fl_create_new_pre_ct(nft_m_entry);
@@ -1267,14 +1316,56 @@ err_nft_ct_merge_insert:
 	return err;
 }
 
+static void
+nfp_ct_merge_tc_idx_bucket(struct nfp_fl_ct_zone_entry *zt,
+			   struct nfp_fl_ct_tc_merge *m_entry, u32 idx_key)
+{
+	struct nfp_fl_ct_flow_entry *nft_entry;
+	struct hlist_node *tmp;
+
+	hash_for_each_possible_safe(zt->nft_flows_idx, nft_entry, tmp,
+				    idx_node, idx_key)
+		if (nft_entry->idx_key == idx_key)
+			nfp_ct_do_nft_merge(zt, nft_entry, m_entry);
+}
+
+static void nfp_ct_merge_tc_with_nft(struct nfp_fl_ct_zone_entry *zt,
+				     struct nfp_fl_ct_tc_merge *m_entry)
+{
+	struct nfp_fl_ct_flow_entry *nft_entry, *nft_tmp;
+	u16 n_proto;
+	u8 ip_proto;
+
+	n_proto = FIELD_GET(NFP_FL_CT_IDX_N_PROTO, m_entry->idx_key);
+	ip_proto = FIELD_GET(NFP_FL_CT_IDX_IP_PROTO, m_entry->idx_key);
+
+	/* Fully specified protocols, only the matching bucket and nft flows
+	 * without protocol information can hold candidates.
+	 */
+	if (n_proto && ip_proto) {
+		nfp_ct_merge_tc_idx_bucket(zt, m_entry, m_entry->idx_key);
+		nfp_ct_merge_tc_idx_bucket(zt, m_entry, 0);
+		return;
+	}
+
+	list_for_each_entry_safe(nft_entry, nft_tmp, &zt->nft_flows_list,
+				 list_node) {
+		if (n_proto && nft_entry->idx_key &&
+		    FIELD_GET(NFP_FL_CT_IDX_N_PROTO, nft_entry->idx_key) != n_proto)
+			continue;
+		nfp_ct_do_nft_merge(zt, nft_entry, m_entry);
+	}
+}
+
 static int nfp_ct_do_tc_merge(struct nfp_fl_ct_zone_entry *zt,
 			      struct nfp_fl_ct_flow_entry *ct_entry1,
 			      struct nfp_fl_ct_flow_entry *ct_entry2)
 {
 	struct nfp_fl_ct_flow_entry *post_ct_entry, *pre_ct_entry;
-	struct nfp_fl_ct_flow_entry *nft_entry, *nft_tmp;
 	struct nfp_fl_ct_tc_merge *m_entry;
 	unsigned long new_cookie[2];
+	__be16 n_proto = 0;
+	u8 ip_proto = 0;
 	int err;
 
 	if (ct_entry1->type == CT_TYPE_PRE_CT) {
@@ -1291,6 +1382,7 @@ static int nfp_ct_do_tc_merge(struct nfp_fl_ct_zone_entry *zt,
 	if (post_ct_entry->chain_index != pre_ct_entry->goto_chain_index)
 		return -EINVAL;
 
+	zt->priv->ct_merge_stats.tc_attempts++;
 	err = nfp_ct_merge_check(pre_ct_entry, post_ct_entry);
 	if (err)
 		return err;
@@ -1321,12 +1413,18 @@ static int nfp_ct_do_tc_merge(struct nfp_fl_ct_zone_entry *zt,
 	if (err)
 		goto err_ct_tc_merge_insert;
 	zt->tc_merge_count++;
+	zt->priv->ct_merge_stats.tc_merges++;
+
+	/* Both flows passed the merge check, so any protocol specified by
+	 * one of them is compatible with the other.
+	 */
+	nfp_ct_merge_idx_proto(pre_ct_entry->rule, &n_proto, &ip_proto);
+	nfp_ct_merge_idx_proto(post_ct_entry->rule, &n_proto, &ip_proto);
+	m_entry->idx_key = nfp_ct_merge_idx_key(n_proto, ip_proto);
+	hash_add(zt->tc_merge_idx, &m_entry->idx_node, m_entry->idx_key);
 
 	/* Merge with existing nft flows */
-	list_for_each_entry_safe(nft_entry, nft_tmp, &zt->nft_flows_list,
-				 list_node) {
-		nfp_ct_do_nft_merge(zt, nft_entry, m_entry);
-	}
+	nfp_ct_merge_tc_with_nft(zt, m_entry);
 
 	return 0;
 
@@ -1368,6 +1466,9 @@ nfp_fl_ct_zone_entry *get_nfp_zone_entry(struct nfp_flower_priv *priv,
 	INIT_LIST_HEAD(&zt->pre_ct_list);
 	INIT_LIST_HEAD(&zt->post_ct_list);
 	INIT_LIST_HEAD(&zt->nft_flows_list);
+	hash_init(zt->tc_merge_idx);
+	hash_init(zt->nft_flows_idx);
+	zt->stats_synced = jiffies - NFP_FL_CT_STATS_SYNC_IVAL;
 
 	err = rhashtable_init(&zt->tc_merge_tb, &nfp_tc_ct_merge_params);
 	if (err)
@@ -1677,6 +1778,7 @@ static void nfp_del_tc_merge_entry(struct nfp_fl_ct_tc_merge *m_ent)
 				     nfp_tc_ct_merge_params);
 	if (err)
 		pr_warn("WARNING: could not remove merge_entry from hashtable\n");
+	hash_del(&m_ent->idx_node);
 	zt->tc_merge_count--;
 	list_del(&m_ent->post_ct_list);
 	list_del(&m_ent->pre_ct_list);
@@ -1709,6 +1811,7 @@ static void nfp_free_tc_merge_children(struct nfp_fl_ct_flow_entry *entry)
 void nfp_fl_ct_clean_flow_entry(struct nfp_fl_ct_flow_entry *entry)
 {
 	list_del(&entry->list_node);
+	hash_del(&entry->idx_node);
 
 	if (!list_empty(&entry->children)) {
 		if (entry->type == CT_TYPE_NFT)
@@ -1782,24 +1885,43 @@ nfp_ct_merge_tc_entries(struct nfp_fl_ct_flow_entry *ct_entry1,
 	}
 }
 
+static void
+nfp_ct_merge_nft_idx_bucket(struct nfp_fl_ct_flow_entry *nft_entry,
+			    struct nfp_fl_ct_zone_entry *zt, u32 idx_key)
+{
+	struct nfp_fl_ct_tc_merge *tc_merge_entry;
+	struct hlist_node *tmp;
+
+	hash_for_each_possible_safe(zt->tc_merge_idx, tc_merge_entry, tmp,
+				    idx_node, idx_key)
+		if (tc_merge_entry->idx_key == idx_key)
+			nfp_ct_do_nft_merge(zt, nft_entry, tc_merge_entry);
+}
+
 static void
 nfp_ct_merge_nft_with_tc(struct nfp_fl_ct_flow_entry *nft_entry,
 			 struct nfp_fl_ct_zone_entry *zt)
 {
 	struct nfp_fl_ct_tc_merge *tc_merge_entry;
-	struct rhashtable_iter iter;
+	u32 idx_key = nft_entry->idx_key;
+	struct hlist_node *tmp;
+	int bkt;
+
+	/* No protocol information, every tc merge is a candidate */
+	if (!idx_key) {
+		hash_for_each_safe(zt->tc_merge_idx, bkt, tmp, tc_merge_entry,
+				   idx_node)
+			nfp_ct_do_nft_merge(zt, nft_entry, tc_merge_entry);
+		return;
+	}
 
-	rhashtable_walk_enter(&zt->tc_merge_tb, &iter);
-	rhashtable_walk_start(&iter);
-	while ((tc_merge_entry = rhashtable_walk_next(&iter)) != NULL) {
-		if (IS_ERR(tc_merge_entry))
-			continue;
-		rhashtable_walk_stop(&iter);
-		nfp_ct_do_nft_merge(zt, nft_entry, tc_merge_entry);
-		rhashtable_walk_start(&iter);
+	nfp_ct_merge_nft_idx_bucket(nft_entry, zt, idx_key);
+	if (FIELD_GET(NFP_FL_CT_IDX_IP_PROTO, idx_key)) {
+		idx_key &= ~NFP_FL_CT_IDX_IP_PROTO;
+		nfp_ct_merge_nft_idx_bucket(nft_entry, zt, idx_key);
 	}
-	rhashtable_walk_stop(&iter);
-	rhashtable_walk_exit(&iter);
+	if (idx_key)
+		nfp_ct_merge_nft_idx_bucket(nft_entry, zt, 0);
 }
 
 int nfp_fl_ct_handle_pre_ct(struct nfp_flower_priv *priv,
@@ -2060,6 +2182,51 @@ nfp_fl_ct_sub_stats(struct nfp_fl_nft_tc_merge *nft_merge,
 	priv->stats[ctx_id].bytes = 0;
 }
 
+/* Netfilter asks for the stats of each offloaded nft flow separately, on
+ * every flowtable GC pass. Rather than walking the merged flows of one nft
+ * entry per request, fold the counters of all merged flows of the zone into
+ * the cached nft entry stats in a single pass, and serve the requests in
+ * between from that cache.
+ *
+ * Must be called with the nfp_fl_lock held, which keeps the zone lists
+ * stable. The stats_lock is only held for a batch of nft flows at a time
+ * so large zones do not hold off the stats message handler.
+ */
+static void nfp_fl_ct_zone_sync_nft_stats(struct nfp_fl_ct_zone_entry *zt)
+{
+	struct nfp_fl_nft_tc_merge *nft_merge, *nft_m_tmp;
+	struct nfp_flower_priv *priv = zt->priv;
+	struct nfp_fl_ct_flow_entry *nft_entry;
+	u64 pkts, bytes, used;
+	unsigned int cnt = 0;
+
+	lockdep_assert_held(&priv->nfp_fl_lock);
+
+	spin_lock_bh(&priv->stats_lock);
+	list_for_each_entry(nft_entry, &zt->nft_flows_list, list_node) {
+		if (cnt++ == NFP_FL_CT_STATS_SYNC_BATCH) {
+			spin_unlock_bh(&priv->stats_lock);
+			cond_resched();
+			spin_lock_bh(&priv->stats_lock);
+			cnt = 1;
+		}
+
+		pkts = 0;
+		bytes = 0;
+		used = 0;
+		list_for_each_entry_safe(nft_merge, nft_m_tmp,
+					 &nft_entry->children, nft_flow_list) {
+			nfp_fl_ct_sub_stats(nft_merge, CT_TYPE_NFT,
+					    &pkts, &bytes, &used);
+		}
+		flow_stats_update(&nft_entry->stats, bytes, pkts, 0, used,
+				  FLOW_ACTION_HW_STATS_DELAYED);
+	}
+	spin_unlock_bh(&priv->stats_lock);
+
+	zt->stats_synced = jiffies;
+}
+
 int nfp_fl_ct_stats(struct flow_cls_offload *flow,
 		    struct nfp_fl_ct_map_entry *ct_map_ent)
 {
@@ -2070,6 +2237,14 @@ int nfp_fl_ct_stats(struct flow_cls_offload *flow,
 	u64 pkts = 0, bytes = 0, used = 0;
 	u64 m_pkts, m_bytes, m_used;
 
+	/* Stats of nft flows are collected for the whole zone at once, the
+	 * cached stats of this entry are recent enough in between.
+	 */
+	if (ct_entry->type == CT_TYPE_NFT &&
+	    time_after_eq(jiffies, ct_entry->zt->stats_synced +
+				   NFP_FL_CT_STATS_SYNC_IVAL))
+		nfp_fl_ct_zone_sync_nft_stats(ct_entry->zt);
+
 	spin_lock_bh(&ct_entry->zt->priv->stats_lock);
 
 	if (ct_entry->type == CT_TYPE_PRE_CT) {
@@ -2114,13 +2289,6 @@ int nfp_fl_ct_stats(struct flow_cls_offload *flow,
 					  m_bytes, m_pkts, 0, m_used,
 					  FLOW_ACTION_HW_STATS_DELAYED);
 		}
-	} else  {
-		/* Iterate nft_merge entries associated with this nft flow */
-		list_for_each_entry_safe(nft_merge, nft_m_tmp, &ct_entry->children,
-					 nft_flow_list) {
-			nfp_fl_ct_sub_stats(nft_merge, CT_TYPE_NFT,
-					    &pkts, &bytes, &used);
-		}
 	}
 
 	/* Add stats from this request to stats potentially cached by
@@ -2170,6 +2338,8 @@ nfp_fl_ct_offload_nft_flow(struct nfp_fl_ct_zone_entry *zt, struct flow_cls_offl
 	struct nfp_fl_ct_map_entry *ct_map_ent;
 	struct nfp_fl_ct_flow_entry *ct_entry;
 	struct netlink_ext_ack *extack = NULL;
+	__be16 n_proto = 0;
+	u8 ip_proto = 0;
 
 	extack = flow->common.extack;
 	switch (flow->command) {
@@ -2189,6 +2359,13 @@ nfp_fl_ct_offload_nft_flow(struct nfp_fl_ct_zone_entry *zt, struct flow_cls_offl
 			ct_entry->type = CT_TYPE_NFT;
 			list_add(&ct_entry->list_node, &zt->nft_flows_list);
 			zt->nft_flows_count++;
+
+			nfp_ct_merge_idx_proto(ct_entry->rule, &n_proto,
+					       &ip_proto);
+			ct_entry->idx_key = nfp_ct_merge_idx_key(n_proto,
+								 ip_proto);
+			hash_add(zt->nft_flows_idx, &ct_entry->idx_node,
+				 ct_entry->idx_key);
 			nfp_ct_merge_nft_with_tc(ct_entry, zt);
 		}
 		return 0;
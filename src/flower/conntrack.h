@@ -9,6 +9,13 @@
 
 #define NFP_FL_CT_NO_TUN	0xff
 
+#define NFP_FL_CT_MERGE_IDX_BITS	6
+
+/* Minimum interval between zone wide collections of nft flow stats */
+#define NFP_FL_CT_STATS_SYNC_IVAL	HZ
+/* Number of nft flows folded per stats_lock hold during a zone collection */
+#define NFP_FL_CT_STATS_SYNC_BATCH	64
+
 #define COMPARE_UNMASKED_FIELDS(__match1, __match2, __out)	\
 	do {							\
 		typeof(__match1) _match1 = (__match1);		\
@@ -55,6 +62,11 @@ extern const struct rhashtable_params nfp_nft_ct_merge_params;
  *
  * @nft_merge_tb:	The table of merged tc+nft flows
  * @nft_merge_count:	Keep count of the number of merged tc+nft entries
+ *
+ * @tc_merge_idx:	Merged tc flows indexed by their merge index key
+ * @nft_flows_idx:	nft flows indexed by their merge index key
+ *
+ * @stats_synced:	Time (jiffies) of the last zone wide nft stats collection
  */
 struct nfp_fl_ct_zone_entry {
 	u16 zone;
@@ -77,6 +89,11 @@ struct nfp_fl_ct_zone_entry {
 
 	struct rhashtable nft_merge_tb;
 	unsigned int nft_merge_count;
+
+	DECLARE_HASHTABLE(tc_merge_idx, NFP_FL_CT_MERGE_IDX_BITS);
+	DECLARE_HASHTABLE(nft_flows_idx, NFP_FL_CT_MERGE_IDX_BITS);
+
+	unsigned long stats_synced;
 };
 
 enum ct_entry_type {
@@ -126,6 +143,8 @@ enum nfp_nfp_layer_name {
  * @tun_offset: Used to indicate tunnel action offset in action list
  * @flags:	Used to indicate flow flag like NAT which used by merge.
  * @type:	Type of ct-entry from enum ct_entry_type
+ * @idx_node:	Used by the zone nft_flows_idx, nft entries only
+ * @idx_key:	Merge index key, see nfp_ct_merge_idx_key()
  */
 struct nfp_fl_ct_flow_entry {
 	unsigned long cookie;
@@ -142,6 +161,8 @@ struct nfp_fl_ct_flow_entry {
 	u8 tun_offset;		// Set to NFP_FL_CT_NO_TUN if no tun
 	u8 flags;
 	u8 type;
+	struct hlist_node idx_node;
+	u32 idx_key;
 };
 
 /**
@@ -154,6 +175,8 @@ struct nfp_fl_ct_flow_entry {
  * @pre_ct_parent:	The pre_ct_parent
  * @post_ct_parent:	The post_ct_parent
  * @children:		List of nft merged entries
+ * @idx_node:		Used by the zone tc_merge_idx
+ * @idx_key:		Merge index key, see nfp_ct_merge_idx_key()
  */
 struct nfp_fl_ct_tc_merge {
 	unsigned long cookie[2];
@@ -164,6 +187,8 @@ struct nfp_fl_ct_tc_merge {
 	struct nfp_fl_ct_flow_entry *pre_ct_parent;
 	struct nfp_fl_ct_flow_entry *post_ct_parent;
 	struct list_head children;
+	struct hlist_node idx_node;
+	u32 idx_key;
 };
 
 /**
@@ -3,9 +3,11 @@
 
 #include "nfp_net_compat.h"
 
+#include <linux/debugfs.h>
 #include <linux/etherdevice.h>
 #include <linux/lockdep.h>
 #include <linux/pci.h>
+#include <linux/seq_file.h>
 #include <linux/skbuff.h>
 #include <linux/vmalloc.h>
 #include <net/devlink.h>
@@ -762,6 +764,110 @@ static int nfp_flower_sync_feature_bits(struct nfp_app *app)
 	return 0;
 }
 
+static int nfp_flower_cmsg_rxq_init(struct nfp_flower_priv *app_priv)
+{
+	struct nfp_fl_cmsg_rxq *rxq;
+	int i;
+
+	/* Unbound so that different message types are handled in parallel,
+	 * high priority since port and tunnel updates are latency sensitive.
+	 */
+	app_priv->cmsg_wq = alloc_workqueue("nfp-flower-cmsg",
+					    WQ_UNBOUND | WQ_HIGHPRI, 0);
+	if (!app_priv->cmsg_wq)
+		return -ENOMEM;
+
+	for (i = 0; i < NFP_FL_CMSG_RXQ_NUM; i++) {
+		rxq = &app_priv->cmsg_rxq[i];
+		rxq->priv = app_priv;
+		skb_queue_head_init(&rxq->skbs);
+		INIT_WORK(&rxq->work, nfp_flower_cmsg_process_rx);
+	}
+
+	return 0;
+}
+
+static void nfp_flower_cmsg_rxq_clean(struct nfp_flower_priv *app_priv)
+{
+	int i;
+
+	for (i = 0; i < NFP_FL_CMSG_RXQ_NUM; i++)
+		skb_queue_purge(&app_priv->cmsg_rxq[i].skbs);
+	destroy_workqueue(app_priv->cmsg_wq);
+}
+
+static int nfp_flower_cmsg_rxq_show(struct seq_file *file, void *data)
+{
+	static const char * const names[NFP_FL_CMSG_RXQ_NUM] = {
+		[NFP_FL_CMSG_RXQ_PORT]	= "port",
+		[NFP_FL_CMSG_RXQ_TUN]	= "tun",
+		[NFP_FL_CMSG_RXQ_LAG]	= "lag",
+		[NFP_FL_CMSG_RXQ_MISC]	= "misc",
+	};
+	struct nfp_flower_priv *app_priv = file->private;
+	struct nfp_fl_cmsg_rxq *rxq;
+	int i;
+
+	seq_puts(file, "queue  depth  max_depth  queued  processed  backlogged  dropped\n");
+	for (i = 0; i < NFP_FL_CMSG_RXQ_NUM; i++) {
+		rxq = &app_priv->cmsg_rxq[i];
+		seq_printf(file, "%-5s  %5u  %9u  %lld  %lld  %lld  %lld\n",
+			   names[i], skb_queue_len(&rxq->skbs),
+			   READ_ONCE(rxq->max_depth),
+			   (s64)atomic64_read(&rxq->queued),
+			   (s64)atomic64_read(&rxq->processed),
+			   (s64)atomic64_read(&rxq->backlogged),
+			   (s64)atomic64_read(&rxq->dropped));
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(nfp_flower_cmsg_rxq);
+
+#if VER_NON_RHEL_GE(5, 9) || VER_RHEL_GE(8, 3)
+static int nfp_flower_ct_merge_show(struct seq_file *file, void *data)
+{
+	struct nfp_flower_priv *app_priv = file->private;
+	struct nfp_fl_ct_merge_stats *stats;
+
+	stats = &app_priv->ct_merge_stats;
+	seq_printf(file, "tc_attempts:  %llu\n", READ_ONCE(stats->tc_attempts));
+	seq_printf(file, "tc_merges:    %llu\n", READ_ONCE(stats->tc_merges));
+	seq_printf(file, "nft_attempts: %llu\n", READ_ONCE(stats->nft_attempts));
+	seq_printf(file, "nft_merges:   %llu\n", READ_ONCE(stats->nft_merges));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(nfp_flower_ct_merge);
+#endif
+
+static void nfp_flower_debugfs_add(struct nfp_app *app)
+{
+	struct nfp_flower_priv *app_priv = app->priv;
+
+	if (IS_ERR_OR_NULL(app->pf->ddir))
+		return;
+
+	app_priv->ddir = debugfs_create_dir("flower", app->pf->ddir);
+	if (IS_ERR_OR_NULL(app_priv->ddir))
+		return;
+
+	debugfs_create_file("cmsg_rx", 0400, app_priv->ddir, app_priv,
+			    &nfp_flower_cmsg_rxq_fops);
+#if VER_NON_RHEL_GE(5, 9) || VER_RHEL_GE(8, 3)
+	debugfs_create_file("ct_merge", 0400, app_priv->ddir, app_priv,
+			    &nfp_flower_ct_merge_fops);
+#endif
+}
+
+static void nfp_flower_debugfs_clean(struct nfp_app *app)
+{
+	struct nfp_flower_priv *app_priv = app->priv;
+
+	debugfs_remove_recursive(app_priv->ddir);
+	app_priv->ddir = NULL;
+}
+
 static int nfp_flower_init(struct nfp_app *app)
 {
 	u64 version, features, ctx_count, num_mems;
@@ -832,18 +938,19 @@ static int nfp_flower_init(struct nfp_app *app)
 	app_priv->stats_ring_size = roundup_pow_of_two(ctx_count);
 	app->priv = app_priv;
 	app_priv->app = app;
-	skb_queue_head_init(&app_priv->cmsg_skbs_high);
-	skb_queue_head_init(&app_priv->cmsg_skbs_low);
-	INIT_WORK(&app_priv->cmsg_work, nfp_flower_cmsg_process_rx);
 	init_waitqueue_head(&app_priv->reify_wait_queue);
 
 	init_waitqueue_head(&app_priv->mtu_conf.wait_q);
 	spin_lock_init(&app_priv->mtu_conf.lock);
 
-	err = nfp_flower_metadata_init(app, ctx_count, num_mems);
+	err = nfp_flower_cmsg_rxq_init(app_priv);
 	if (err)
 		goto err_free_app_priv;
 
+	err = nfp_flower_metadata_init(app, ctx_count, num_mems);
+	if (err)
+		goto err_cmsg_rxq_clean;
+
 	/* Extract the extra features supported by the firmware. */
 	features = nfp_rtsym_read_le(app->pf->rtbl,
 				     "_abi_flower_extra_features", &err);
@@ -869,6 +976,8 @@ err_cleanup:
 	if (app_priv->flower_en_feats & NFP_FL_ENABLE_LAG)
 		nfp_flower_lag_cleanup(&app_priv->nfp_lag);
 	nfp_flower_metadata_cleanup(app);
+err_cmsg_rxq_clean:
+	nfp_flower_cmsg_rxq_clean(app_priv);
 err_free_app_priv:
 	vfree(app->priv);
 	return err;
@@ -878,9 +987,7 @@ static void nfp_flower_clean(struct nfp_app *app)
 {
 	struct nfp_flower_priv *app_priv = app->priv;
 
-	skb_queue_purge(&app_priv->cmsg_skbs_high);
-	skb_queue_purge(&app_priv->cmsg_skbs_low);
-	flush_work(&app_priv->cmsg_work);
+	nfp_flower_cmsg_rxq_clean(app_priv);
 
 	if (app_priv->flower_ext_feats & NFP_FL_FEATS_VF_RLIM)
 		nfp_flower_qos_cleanup(app);
@@ -972,6 +1079,8 @@ static int nfp_flower_start(struct nfp_app *app)
 	if (err)
 		goto err_tunnel_config;
 
+	nfp_flower_debugfs_add(app);
+
 	return 0;
 
 err_tunnel_config:
@@ -984,6 +1093,7 @@ err_tunnel_config:
 
 static void nfp_flower_stop(struct nfp_app *app)
 {
+	nfp_flower_debugfs_clean(app);
 	nfp_tunnel_config_stop(app);
 
 #if VER_NON_RHEL_GE(5, 8) || VER_RHEL_GE(8, 3)
@@ -87,7 +87,6 @@ struct nfp_fl_mask_id {
 struct nfp_fl_stats_id {
 	struct circ_buf free_list;
 	u32 init_unalloc;
-	u8 repeated_em_count;
 };
 
 /**
@@ -257,6 +256,54 @@ struct nfp_fl_internal_ports {
 	spinlock_t lock;
 };
 
+/* Control message RX queues, each drained by its own work item so that
+ * slow handlers (e.g. RTNL-bound port updates) do not hold up the others.
+ */
+enum nfp_fl_cmsg_rxq_id {
+	NFP_FL_CMSG_RXQ_PORT,
+	NFP_FL_CMSG_RXQ_TUN,
+	NFP_FL_CMSG_RXQ_LAG,
+	NFP_FL_CMSG_RXQ_MISC,
+
+	NFP_FL_CMSG_RXQ_NUM
+};
+
+/**
+ * struct nfp_fl_cmsg_rxq - Flower APP control message RX queue
+ * @priv:		Back pointer to flower priv data
+ * @work:		Work item draining @skbs
+ * @skbs:		Queued control messages awaiting processing
+ * @max_depth:		Highest observed length of @skbs
+ * @queued:		Number of messages queued
+ * @processed:		Number of messages processed by the work item
+ * @backlogged:		Number of messages queued while work was still pending
+ * @dropped:		Number of messages dropped due to a full queue
+ */
+struct nfp_fl_cmsg_rxq {
+	struct nfp_flower_priv *priv;
+	struct work_struct work;
+	struct sk_buff_head skbs;
+	unsigned int max_depth;
+	atomic64_t queued;
+	atomic64_t processed;
+	atomic64_t backlogged;
+	atomic64_t dropped;
+};
+
+/**
+ * struct nfp_fl_ct_merge_stats - Conntrack merge engine counters
+ * @tc_attempts:	Number of pre_ct/post_ct pairs checked for merging
+ * @tc_merges:		Number of pre_ct/post_ct pairs merged
+ * @nft_attempts:	Number of nft/tc_merge pairs checked for merging
+ * @nft_merges:		Number of nft/tc_merge pairs merged
+ */
+struct nfp_fl_ct_merge_stats {
+	u64 tc_attempts;
+	u64 tc_merges;
+	u64 nft_attempts;
+	u64 nft_merges;
+};
+
 /**
  * struct nfp_flower_priv - Flower APP per-vNIC priv data
  * @app:		Back pointer to app
@@ -271,13 +318,10 @@ struct nfp_fl_internal_ports {
  * @stats_ring_size:	Maximum number of allowed stats ids
  * @flow_table:		Hash table used to store flower rules
  * @stats:		Stored stats updates for flower rules
- * @stats_lock:		Lock for flower rule stats updates
+ * @stats_lock:		Lock for flower rule stats updates and flow links
  * @stats_ctx_table:	Hash table to map stats contexts to its flow rule
- * @cmsg_work:		Workqueue for control messages processing
- * @cmsg_skbs_high:	List of higher priority skbs for control message
- *			processing
- * @cmsg_skbs_low:	List of lower priority skbs for control message
- *			processing
+ * @cmsg_wq:		Workqueue for control messages processing
+ * @cmsg_rxq:		Per message type control message RX queues
  * @tun:		Tunnel offload data
  * @reify_replies:	atomically stores the number of replies received
  *			from firmware for repr reify
@@ -299,10 +343,12 @@ struct nfp_fl_internal_ports {
  * @ct_zone_table:	Hash table used to store the different zones
  * @ct_zone_wc:		Special zone entry for wildcarded zone matches
  * @ct_map_table:	Hash table used to referennce ct flows
+ * @ct_merge_stats:	Conntrack merge counters, protected by @nfp_fl_lock
  * @predt_list:		List to keep track of decap pretun flows
  * @neigh_table:	Table to keep track of neighbor entries
  * @predt_lock:		Lock to serialise predt/neigh table updates
- * @nfp_fl_lock:	Lock to protect the flow offload operation
+ * @nfp_fl_lock:	Lock to serialise flow table, mask and firmware updates
+ * @ddir:		Flower debugfs directory
  */
 struct nfp_flower_priv {
 	struct nfp_app *app;
@@ -319,9 +365,8 @@ struct nfp_flower_priv {
 	struct nfp_fl_stats *stats;
 	spinlock_t stats_lock; /* lock stats */
 	struct rhashtable stats_ctx_table;
-	struct work_struct cmsg_work;
-	struct sk_buff_head cmsg_skbs_high;
-	struct sk_buff_head cmsg_skbs_low;
+	struct workqueue_struct *cmsg_wq;
+	struct nfp_fl_cmsg_rxq cmsg_rxq[NFP_FL_CMSG_RXQ_NUM];
 	struct nfp_fl_tunnel_offloads tun;
 	atomic_t reify_replies;
 	wait_queue_head_t reify_wait_queue;
@@ -343,11 +388,13 @@ struct nfp_flower_priv {
 	struct rhashtable ct_zone_table;
 	struct nfp_fl_ct_zone_entry *ct_zone_wc;
 	struct rhashtable ct_map_table;
+	struct nfp_fl_ct_merge_stats ct_merge_stats;
 #endif
 	struct list_head predt_list;
 	struct rhashtable neigh_table;
 	spinlock_t predt_lock; /* Lock to serialise predt/neigh table updates */
 	struct mutex nfp_fl_lock; /* Protect the flow operation */
+	struct dentry *ddir;
 };
 
 /**
@@ -453,6 +500,7 @@ struct nfp_fl_payload {
 #endif
 	struct list_head linked_flows;
 	bool in_hw;
+	bool stats_released;
 	struct {
 		struct nfp_predt_entry *predt;
 		struct net_device *dev;
@@ -42,19 +42,23 @@ static const struct rhashtable_params stats_ctx_table_params = {
 	.key_len	= sizeof(u32),
 };
 
+/* Stats context ids are only allocated and released with the nfp_fl_lock
+ * held, which also serialises the rest of the flow setup, so the free list
+ * needs no locking of its own.
+ */
 static int nfp_release_stats_entry(struct nfp_app *app, u32 stats_context_id)
 {
 	struct nfp_flower_priv *priv = app->priv;
 	struct circ_buf *ring;
+	u32 *ids;
 
 	ring = &priv->stats_ids.free_list;
 	/* Check if buffer is full, stats_ring_size must be power of 2 */
 	if (!CIRC_SPACE(ring->head, ring->tail, priv->stats_ring_size))
 		return -ENOBUFS;
 
-	/* Each increment of head represents size of NFP_FL_STATS_ELEM_RS */
-	memcpy(&ring->buf[ring->head * NFP_FL_STATS_ELEM_RS],
-	       &stats_context_id, NFP_FL_STATS_ELEM_RS);
+	ids = (u32 *)ring->buf;
+	ids[ring->head] = stats_context_id;
 	ring->head = (ring->head + 1) & (priv->stats_ring_size - 1);
 
 	return 0;
@@ -63,11 +67,10 @@ static int nfp_release_stats_entry(struct nfp_app *app, u32 stats_context_id)
 static int nfp_get_stats_entry(struct nfp_app *app, u32 *stats_context_id)
 {
 	struct nfp_flower_priv *priv = app->priv;
-	u32 freed_stats_id, temp_stats_id;
 	struct circ_buf *ring;
+	u32 *ids;
 
 	ring = &priv->stats_ids.free_list;
-	freed_stats_id = priv->stats_ring_size;
 	/* Check for unallocated entries first. */
 	if (priv->stats_ids.init_unalloc > 0) {
 		*stats_context_id =
@@ -86,23 +89,20 @@ static int nfp_get_stats_entry(struct nfp_app *app, u32 *stats_context_id)
 
 	/* Check if buffer is empty. */
 	if (ring->head == ring->tail) {
-		*stats_context_id = freed_stats_id;
+		*stats_context_id = priv->stats_ring_size;
 		return -ENOENT;
 	}
 
-	/* Each increment of tail represents size of NFP_FL_STATS_ELEM_RS */
-	memcpy(&temp_stats_id, &ring->buf[ring->tail * NFP_FL_STATS_ELEM_RS],
-	       NFP_FL_STATS_ELEM_RS);
-	*stats_context_id = temp_stats_id;
-	memcpy(&ring->buf[ring->tail * NFP_FL_STATS_ELEM_RS], &freed_stats_id,
-	       NFP_FL_STATS_ELEM_RS);
+	ids = (u32 *)ring->buf;
+	*stats_context_id = ids[ring->tail];
+	ids[ring->tail] = priv->stats_ring_size;
 	/* stats_ring_size must be power of 2 */
 	ring->tail = (ring->tail + 1) & (priv->stats_ring_size - 1);
 
 	return 0;
 }
 
-/* Must be called with either RTNL or rcu_read_lock */
+/* Must be called with either the nfp_fl_lock or rcu_read_lock held */
 struct nfp_fl_payload *
 nfp_flower_search_fl_table(struct nfp_app *app, unsigned long tc_flower_cookie,
 			   struct net_device *netdev)
@@ -435,6 +435,13 @@ int nfp_modify_flow_metadata(struct nfp_app *app,
 					    stats_ctx_table_params));
 	kfree(ctx_entry);
 
+	/* Stats readers only hold the stats_lock and RCU, stop them from
+	 * using the id before it can be handed out to another flow.
+	 */
+	spin_lock_bh(&priv->stats_lock);
+	nfp_flow->stats_released = true;
+	spin_unlock_bh(&priv->stats_lock);
+
 	return nfp_release_stats_entry(app, temp_ctx_id);
 }
 
@@ -834,6 +834,7 @@ nfp_flower_allocate_new(struct nfp_fl_key_ls *key_layer)
 #endif
 	INIT_LIST_HEAD(&flow_pay->linked_flows);
 	flow_pay->in_hw = false;
+	flow_pay->stats_released = false;
 	flow_pay->pre_tun_rule.dev = NULL;
 
 	return flow_pay;
@@ -1216,7 +1217,9 @@ nfp_flower_merge_action(struct nfp_fl_payload *sub_flow1,
 	return 0;
 }
 
-/* Flow link code should only be accessed under RTNL. */
+/* Flow links are only modified under the nfp_fl_lock. The stats path walks
+ * them without it, so they must also be modified with the stats_lock held.
+ */
 static void nfp_flower_unlink_flow(struct nfp_fl_payload_link *link)
 {
 	list_del(&link->merge_flow.list);
@@ -1224,19 +1227,23 @@ static void nfp_flower_unlink_flow(struct nfp_fl_payload_link *link)
 	kfree(link);
 }
 
-static void nfp_flower_unlink_flows(struct nfp_fl_payload *merge_flow,
+static void nfp_flower_unlink_flows(struct nfp_flower_priv *priv,
+				    struct nfp_fl_payload *merge_flow,
 				    struct nfp_fl_payload *sub_flow)
 {
 	struct nfp_fl_payload_link *link;
 
+	spin_lock_bh(&priv->stats_lock);
 	list_for_each_entry(link, &merge_flow->linked_flows, merge_flow.list)
 		if (link->sub_flow.flow == sub_flow) {
 			nfp_flower_unlink_flow(link);
-			return;
+			break;
 		}
+	spin_unlock_bh(&priv->stats_lock);
 }
 
-static int nfp_flower_link_flows(struct nfp_fl_payload *merge_flow,
+static int nfp_flower_link_flows(struct nfp_flower_priv *priv,
+				 struct nfp_fl_payload *merge_flow,
 				 struct nfp_fl_payload *sub_flow)
 {
 	struct nfp_fl_payload_link *link;
@@ -1245,10 +1252,12 @@ static int nfp_flower_link_flows(struct nfp_fl_payload *merge_flow,
 	if (!link)
 		return -ENOMEM;
 
+	spin_lock_bh(&priv->stats_lock);
 	link->merge_flow.flow = merge_flow;
 	list_add_tail(&link->merge_flow.list, &merge_flow->linked_flows);
 	link->sub_flow.flow = sub_flow;
 	list_add_tail(&link->sub_flow.list, &sub_flow->linked_flows);
+	spin_unlock_bh(&priv->stats_lock);
 
 	return 0;
 }
@@ -1315,11 +1324,11 @@ int nfp_flower_merge_offloaded_flows(struct nfp_app *app,
 	if (err)
 		goto err_destroy_merge_flow;
 
-	err = nfp_flower_link_flows(merge_flow, sub_flow1);
+	err = nfp_flower_link_flows(priv, merge_flow, sub_flow1);
 	if (err)
 		goto err_destroy_merge_flow;
 
-	err = nfp_flower_link_flows(merge_flow, sub_flow2);
+	err = nfp_flower_link_flows(priv, merge_flow, sub_flow2);
 	if (err)
 		goto err_unlink_sub_flow1;
 
@@ -1367,9 +1376,9 @@ err_remove_rhash:
 err_release_metadata:
 	nfp_modify_flow_metadata(app, merge_flow);
 err_unlink_sub_flow2:
-	nfp_flower_unlink_flows(merge_flow, sub_flow2);
+	nfp_flower_unlink_flows(priv, merge_flow, sub_flow2);
 err_unlink_sub_flow1:
-	nfp_flower_unlink_flows(merge_flow, sub_flow1);
+	nfp_flower_unlink_flows(priv, merge_flow, sub_flow1);
 err_destroy_merge_flow:
 	kfree(merge_flow->action_data);
 	kfree(merge_flow->mask_data);
@@ -1628,11 +1637,19 @@ nfp_flower_add_offload(struct nfp_app *app, struct net_device *netdev,
 		port = nfp_port_from_netdev(netdev);
 
 #if VER_NON_RHEL_GE(5, 9) || VER_RHEL_GE(8, 3)
-	if (is_pre_ct_flow(flow))
-		return nfp_fl_ct_handle_pre_ct(priv, netdev, flow, extack, NULL);
+	if (is_pre_ct_flow(flow)) {
+		mutex_lock(&priv->nfp_fl_lock);
+		err = nfp_fl_ct_handle_pre_ct(priv, netdev, flow, extack, NULL);
+		mutex_unlock(&priv->nfp_fl_lock);
+		return err;
+	}
 
-	if (is_post_ct_flow(flow))
-		return nfp_fl_ct_handle_post_ct(priv, netdev, flow, extack);
+	if (is_post_ct_flow(flow)) {
+		mutex_lock(&priv->nfp_fl_lock);
+		err = nfp_fl_ct_handle_post_ct(priv, netdev, flow, extack);
+		mutex_unlock(&priv->nfp_fl_lock);
+		return err;
+	}
 
 	if (!offload_pre_check(flow))
 		return -EOPNOTSUPP;
@@ -1707,6 +1724,12 @@ nfp_flower_add_offload(struct nfp_app *app, struct net_device *netdev,
 			goto err_destroy_flow;
 	}
 
+	/* Everything above only translates the TC rule and can run for many
+	 * flows in parallel. From here on mask ids, stats contexts and the
+	 * flow version are allocated and the flow is sent to the firmware,
+	 * which must happen in the same order.
+	 */
+	mutex_lock(&priv->nfp_fl_lock);
 #if VER_NON_RHEL_LT(5, 0)
 	err = nfp_compile_flow_metadata(app, flow->cookie, flow_pay,
 					flow_pay->ingress_dev, extack);
@@ -1714,7 +1737,7 @@ nfp_flower_add_offload(struct nfp_app *app, struct net_device *netdev,
 	err = nfp_compile_flow_metadata(app, flow->cookie, flow_pay, netdev, extack);
 #endif
 	if (err)
-		goto err_destroy_flow;
+		goto err_unlock;
 
 	flow_pay->tc_flower_cookie = flow->cookie;
 	err = rhashtable_insert_fast(&priv->flow_table, &flow_pay->fl_node,
@@ -1755,6 +1778,7 @@ nfp_flower_add_offload(struct nfp_app *app, struct net_device *netdev,
 		port->tc_offload_cnt++;
 
 	flow_pay->in_hw = true;
+	mutex_unlock(&priv->nfp_fl_lock);
 
 	/* Deallocate flow payload when flower rule has been destroyed. */
 	kfree(key_layer);
@@ -1767,6 +1791,8 @@ err_remove_rhash:
 					    nfp_flower_table_params));
 err_release_metadata:
 	nfp_modify_flow_metadata(app, flow_pay);
+err_unlock:
+	mutex_unlock(&priv->nfp_fl_lock);
 err_destroy_flow:
 	if (flow_pay->nfp_tun_ipv6)
 		nfp_tunnel_put_ipv6_off(app, flow_pay->nfp_tun_ipv6);
@@ -1824,6 +1850,7 @@ nfp_flower_remove_merge_flow(struct nfp_app *app,
 
 err_free_links:
 	/* Clean any links connected with the merged flow. */
+	spin_lock_bh(&priv->stats_lock);
 	list_for_each_entry_safe(link, temp, &merge_flow->linked_flows,
 				 merge_flow.list) {
 		u32 ctx_id = be32_to_cpu(link->sub_flow.flow->meta.host_ctx_id);
@@ -1831,6 +1858,7 @@ err_free_links:
 		parent_ctx = (parent_ctx << 32) | (u64)(ctx_id);
 		nfp_flower_unlink_flow(link);
 	}
+	spin_unlock_bh(&priv->stats_lock);
 
 	merge_info = rhashtable_lookup_fast(&priv->merge_table,
 					    &parent_ctx,
@@ -1989,6 +2017,9 @@ __nfp_flower_update_merge_stats(struct nfp_app *app,
 	u64 pkts, bytes, used;
 	u32 ctx_id;
 
+	if (merge_flow->stats_released)
+		return;
+
 	ctx_id = be32_to_cpu(merge_flow->meta.host_ctx_id);
 	pkts = priv->stats[ctx_id].pkts;
 	/* Do not cycle subflows if no stats to distribute. */
@@ -2007,6 +2038,8 @@ __nfp_flower_update_merge_stats(struct nfp_app *app,
 	 */
 	list_for_each_entry(link, &merge_flow->linked_flows, merge_flow.list) {
 		sub_flow = link->sub_flow.flow;
+		if (sub_flow->stats_released)
+			continue;
 		ctx_id = be32_to_cpu(sub_flow->meta.host_ctx_id);
 		priv->stats[ctx_id].pkts += pkts;
 		priv->stats[ctx_id].bytes += bytes;
@@ -2060,16 +2093,34 @@ nfp_flower_get_stats(struct nfp_app *app, struct net_device *netdev,
 	u32 ctx_id;
 
 #if VER_NON_RHEL_GE(5, 9) || VER_RHEL_GE(8, 3)
-	/* Check ct_map table first */
-	ct_map_ent = rhashtable_lookup_fast(&priv->ct_map_table, &flow->cookie,
-					    nfp_ct_map_params);
-	if (ct_map_ent)
-		return nfp_fl_ct_stats(flow, ct_map_ent);
+	/* Check ct_map table first. Conntrack stats walk the zone tables so
+	 * they are still collected under the nfp_fl_lock.
+	 */
+	if (rhashtable_lookup_fast(&priv->ct_map_table, &flow->cookie,
+				   nfp_ct_map_params)) {
+		int err = -EINVAL;
+
+		mutex_lock(&priv->nfp_fl_lock);
+		ct_map_ent = rhashtable_lookup_fast(&priv->ct_map_table,
+						    &flow->cookie,
+						    nfp_ct_map_params);
+		if (ct_map_ent)
+			err = nfp_fl_ct_stats(flow, ct_map_ent);
+		mutex_unlock(&priv->nfp_fl_lock);
+
+		return err;
+	}
 #endif
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 16, 0)
 	extack = flow->common.extack;
 #endif
+	/* Non-conntrack stats only need the flow to stay around while its
+	 * counters are read, payloads are freed after an RCU grace period.
+	 * A flow being deleted may already have given its stats context id
+	 * back, which is checked under the stats_lock.
+	 */
+	rcu_read_lock();
 #if VER_NON_RHEL_LT(5, 0)
 	ingr_dev = egress ? NULL : netdev;
 	nfp_flow = nfp_flower_search_fl_table(app, flow->cookie, ingr_dev);
@@ -2077,18 +2128,27 @@ nfp_flower_get_stats(struct nfp_app *app, struct net_device *netdev,
 	nfp_flow = nfp_flower_search_fl_table(app, flow->cookie, netdev);
 #endif
 	if (!nfp_flow) {
+		rcu_read_unlock();
 		NL_SET_ERR_MSG_MOD(extack, "invalid entry: cannot dump stats for flow that does not exist");
 		return -EINVAL;
 	}
 
 #if VER_NON_RHEL_LT(5, 0)
-	if (nfp_flow->ingress_offload && egress)
+	if (nfp_flow->ingress_offload && egress) {
+		rcu_read_unlock();
 		return 0;
+	}
 
 #endif
 	ctx_id = be32_to_cpu(nfp_flow->meta.host_ctx_id);
 
 	spin_lock_bh(&priv->stats_lock);
+	if (nfp_flow->stats_released) {
+		spin_unlock_bh(&priv->stats_lock);
+		rcu_read_unlock();
+		return 0;
+	}
+
 	/* If request is for a sub_flow, update stats from merged flows. */
 	if (!list_empty(&nfp_flow->linked_flows))
 		nfp_flower_update_merge_stats(app, nfp_flow);
@@ -2107,6 +2167,7 @@ nfp_flower_get_stats(struct nfp_app *app, struct net_device *netdev,
 	priv->stats[ctx_id].pkts = 0;
 	priv->stats[ctx_id].bytes = 0;
 	spin_unlock_bh(&priv->stats_lock);
+	rcu_read_unlock();
 
 	return 0;
 }
@@ -2128,7 +2189,10 @@ nfp_flower_repr_offload(struct nfp_app *app, struct net_device *netdev,
 	if (!eth_proto_is_802_3(flower->common.protocol))
 		return -EOPNOTSUPP;
 #endif
-	mutex_lock(&priv->nfp_fl_lock);
+	/* Adds take the nfp_fl_lock themselves once the rule has been
+	 * translated and stats are read under RCU, only deletes need the
+	 * lock for the whole operation.
+	 */
 	switch (flower->command) {
 	case FLOW_CLS_REPLACE:
 #if VER_NON_RHEL_LT(5, 0)
@@ -2138,11 +2202,13 @@ nfp_flower_repr_offload(struct nfp_app *app, struct net_device *netdev,
 #endif
 		break;
 	case FLOW_CLS_DESTROY:
+		mutex_lock(&priv->nfp_fl_lock);
 #if VER_NON_RHEL_LT(5, 0)
 		ret = nfp_flower_del_offload(app, netdev, flower, egress);
 #else
 		ret = nfp_flower_del_offload(app, netdev, flower);
 #endif
+		mutex_unlock(&priv->nfp_fl_lock);
 		break;
 	case FLOW_CLS_STATS:
 #if VER_NON_RHEL_LT(5, 0)
@@ -2155,7 +2221,6 @@ nfp_flower_repr_offload(struct nfp_app *app, struct net_device *netdev,
 		ret = -EOPNOTSUPP;
 		break;
 	}
-	mutex_unlock(&priv->nfp_fl_lock);
 
 	return ret;
 }
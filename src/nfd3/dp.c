@@ -329,14 +329,18 @@ netdev_tx_t nfp_nfd3_tx(struct sk_buff *skb, struct net_device *netdev)
 	if (unlikely(compat_ndo_features_check(nn, skb)))
 		goto err_flush;
 
-	/* Start with the head skbuf */
-	dma_addr = dma_map_single(dp->dev, skb->data, skb_headlen(skb),
-				  DMA_TO_DEVICE);
-	if (dma_mapping_error(dp->dev, dma_addr))
-		goto err_dma_err;
-
 	wr_idx = D_IDX(tx_ring, tx_ring->wr_p);
 
+	/* Start with the head skbuf */
+	if (nfp_net_tx_can_copybreak(tx_ring, skb)) {
+		dma_addr = nfp_net_tx_copybreak(tx_ring, skb, wr_idx);
+	} else {
+		dma_addr = dma_map_single(dp->dev, skb->data,
+					  skb_headlen(skb), DMA_TO_DEVICE);
+		if (dma_mapping_error(dp->dev, dma_addr))
+			goto err_dma_err;
+	}
+
 	/* Stash the soft descriptor of the head then initialize it */
 	txbuf = &tx_ring->txbufs[wr_idx];
 	txbuf->skb = skb;
@@ -488,8 +492,10 @@ void nfp_nfd3_tx_complete(struct nfp_net_tx_ring *tx_ring, int budget)
 
 		if (fidx == -1) {
 			/* unmap head */
-			dma_unmap_single(dp->dev, tx_buf->dma_addr,
-					 skb_headlen(skb), DMA_TO_DEVICE);
+			if (!nfp_net_tx_is_copybreak(tx_ring, tx_buf->dma_addr))
+				dma_unmap_single(dp->dev, tx_buf->dma_addr,
+						 skb_headlen(skb),
+						 DMA_TO_DEVICE);
 
 			done_pkts += tx_buf->pkt_cnt;
 			done_bytes += tx_buf->real_len;
@@ -516,6 +522,8 @@ void nfp_nfd3_tx_complete(struct nfp_net_tx_ring *tx_ring, int budget)
 	r_vec->tx_pkts += done_pkts;
 	u64_stats_update_end(&r_vec->tx_sync);
 
+	nfp_net_ring_stats_tx_done(tx_ring, done_pkts);
+
 	if (!dp->netdev)
 		return;
 
@@ -770,6 +778,50 @@ nfp_nfd3_set_hash_desc(struct net_device *netdev, struct nfp_meta_parsed *meta,
 			  &rx_hash->hash);
 }
 
+/**
+ * nfp_nfd3_parse_meta_fast() - Parse the common hash (and mark) only metadata
+ * @netdev: netdev structure
+ * @meta: Parsed metadata output
+ * @data: Metadata prepend
+ * @meta_len: Length of the metadata prepend
+ *
+ * With RSS on, most packets carry just the hash, possibly followed by a mark
+ * from the BPF offload.  Recognize those layouts with a single compare of
+ * the field list instead of walking it.
+ *
+ * Return: true if the metadata was parsed, false if the generic parser
+ * has to be used.
+ */
+static bool
+nfp_nfd3_parse_meta_fast(struct net_device *netdev,
+			 struct nfp_meta_parsed *meta, void *data,
+			 int meta_len)
+{
+	u32 meta_info;
+
+	meta_info = get_unaligned_be32(data);
+
+	switch (meta_info & ~NFP_NET_META_HASH_TYPE_MASK) {
+	case NFP_NET_META_HASH:
+		if (meta_len != 8)
+			return false;
+		break;
+	case NFP_NET_META_HASH |
+	     NFP_NET_META_MARK << (2 * NFP_NET_META_FIELD_SIZE):
+		if (meta_len != 12)
+			return false;
+		meta->mark = get_unaligned_be32(data + 8);
+		break;
+	default:
+		return false;
+	}
+
+	nfp_nfd3_set_hash(netdev, meta,
+			  FIELD_GET(NFP_NET_META_HASH_TYPE_MASK, meta_info),
+			  (__be32 *)(data + 4));
+	return true;
+}
+
 bool
 nfp_nfd3_parse_meta(struct net_device *netdev, struct nfp_meta_parsed *meta,
 		    void *data, void *pkt, unsigned int pkt_len, int meta_len)
@@ -838,6 +890,19 @@ nfp_nfd3_parse_meta(struct net_device *netdev, struct nfp_meta_parsed *meta,
 	return data != pkt;
 }
 
+static bool
+nfp_nfd3_rx_parse_meta(const struct nfp_net_dp *dp,
+		       struct nfp_meta_parsed *meta, void *data, void *pkt,
+		       unsigned int pkt_len, int meta_len)
+{
+	if (dp->rx_meta_fast &&
+	    nfp_nfd3_parse_meta_fast(dp->netdev, meta, data, meta_len))
+		return false;
+
+	return nfp_nfd3_parse_meta(dp->netdev, meta, data, pkt, pkt_len,
+				   meta_len);
+}
+
 static void
 nfp_nfd3_rx_drop(const struct nfp_net_dp *dp, struct nfp_net_r_vector *r_vec,
 		 struct nfp_net_rx_ring *rx_ring, struct nfp_net_rx_buf *rxbuf,
@@ -1033,10 +1098,10 @@ static int nfp_nfd3_rx(struct nfp_net_rx_ring *rx_ring, int budget)
 			nfp_nfd3_set_hash_desc(dp->netdev, &meta,
 					       rxbuf->frag + meta_off, rxd);
 		} else if (meta_len) {
-			if (unlikely(nfp_nfd3_parse_meta(dp->netdev, &meta,
-							 rxbuf->frag + meta_off,
-							 rxbuf->frag + pkt_off,
-							 pkt_len, meta_len))) {
+			if (unlikely(nfp_nfd3_rx_parse_meta(dp, &meta,
+							    rxbuf->frag + meta_off,
+							    rxbuf->frag + pkt_off,
+							    pkt_len, meta_len))) {
 				nn_dp_warn(dp, "invalid RX packet metadata\n");
 				nfp_nfd3_rx_drop(dp, r_vec, rx_ring, rxbuf,
 						 NULL);
@@ -1222,9 +1287,10 @@ int nfp_nfd3_poll(struct napi_struct *napi, int budget)
 	if (r_vec->rx_ring)
 		pkts_polled = nfp_nfd3_rx(r_vec->rx_ring, budget);
 
+	nfp_net_ring_stats_poll(r_vec, pkts_polled, budget);
+
 	if (pkts_polled < budget)
-		if (napi_complete_done(napi, pkts_polled))
-			nfp_net_irq_unmask(r_vec->nfp_net, r_vec->irq_entry);
+		nfp_net_napi_complete(r_vec, pkts_polled);
 
 #ifdef COMPAT_HAVE_DIM
 	if (r_vec->nfp_net->rx_coalesce_adapt_on && r_vec->rx_ring) {
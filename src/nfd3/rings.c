@@ -61,8 +61,10 @@ nfp_nfd3_tx_ring_reset(struct nfp_net_dp *dp, struct nfp_net_tx_ring *tx_ring)
 
 		if (tx_buf->fidx == -1) {
 			/* unmap head */
-			dma_unmap_single(dp->dev, tx_buf->dma_addr,
-					 skb_headlen(skb), DMA_TO_DEVICE);
+			if (!nfp_net_tx_is_copybreak(tx_ring, tx_buf->dma_addr))
+				dma_unmap_single(dp->dev, tx_buf->dma_addr,
+						 skb_headlen(skb),
+						 DMA_TO_DEVICE);
 		} else {
 			/* unmap fragment */
 			frag = &skb_shinfo(skb)->frags[tx_buf->fidx];
@@ -419,8 +419,8 @@ int nfp_nfd3_xsk_poll(struct napi_struct *napi, int budget)
 
 		nfp_nfd3_xsk_tx(r_vec->xdp_ring);
 
-		if (pkts_polled < budget && napi_complete_done(napi, skbs))
-			nfp_net_irq_unmask(r_vec->nfp_net, r_vec->irq_entry);
+		if (pkts_polled < budget)
+			nfp_net_napi_complete(r_vec, skbs);
 	}
 
 	return pkts_polled;
@@ -11,6 +11,9 @@
 #include <linux/overflow.h>
 #endif
 #include <linux/sizes.h>
+#include <net/ip6_checksum.h>
+#include <net/ipv6.h>
+#include <net/tcp.h>
 #include <net/xfrm.h>
 
 #include "../nfp_app.h"
@@ -20,6 +23,10 @@
 #include "../crypto/fw.h"
 #include "nfdk.h"
 
+static bool nfdk_tx_pack;
+module_param(nfdk_tx_pack, bool, 0644);
+MODULE_PARM_DESC(nfdk_tx_pack, "Hold back a packet which would leave its NFDK TX block partially unused, allowing packets of other local sockets to fill it, forwarded packets are never reordered (default = false)");
+
 static int nfp_nfdk_tx_ring_should_wake(struct nfp_net_tx_ring *tx_ring)
 {
 	return !nfp_net_tx_full(tx_ring, NFDK_TX_DESC_STOP_CNT * 2);
@@ -128,15 +135,62 @@ nfp_nfdk_tx_csum(struct nfp_net_dp *dp, struct nfp_net_r_vector *r_vec,
 	return flags;
 }
 
+/**
+ * nfp_nfdk_tx_pull_frags() - merge leading frags into the head
+ * @skb:	packet which needs too many descriptors
+ * @n_descs:	number of descriptors @skb needs now
+ *
+ * Pull just enough of the frags following the head into it for the packet
+ * to fit into NFDK_TX_DESC_GATHER_MAX descriptors.  This copies at most
+ * NFDK_TX_MAX_PULL bytes rather than the whole packet.
+ *
+ * Return: 0 on success, negative errno otherwise.
+ */
+static int nfp_nfdk_tx_pull_frags(struct sk_buff *skb, unsigned int n_descs)
+{
+	unsigned int headlen = skb_headlen(skb);
+	const skb_frag_t *frag, *fend;
+	unsigned int size, pull = 0;
+
+	frag = skb_shinfo(skb)->frags;
+	fend = frag + skb_shinfo(skb)->nr_frags;
+	while (n_descs > NFDK_TX_DESC_GATHER_MAX) {
+		if (frag >= fend)
+			return -E2BIG;
+
+		size = skb_frag_size(frag);
+		n_descs -= nfp_nfdk_headlen_to_segs(headlen + pull);
+		n_descs -= DIV_ROUND_UP(size, NFDK_TX_MAX_DATA_PER_DESC);
+		pull += size;
+		n_descs += nfp_nfdk_headlen_to_segs(headlen + pull);
+		frag++;
+	}
+
+	if (pull > NFDK_TX_MAX_PULL)
+		return -E2BIG;
+
+	if (!__pskb_pull_tail(skb, pull))
+		return -ENOMEM;
+
+	return 0;
+}
+
+/**
+ * nfp_nfdk_tx_block_check() - check if a packet fits the current block
+ * @tx_ring:	TX ring structure
+ * @skb:	packet to send, may get linearized
+ *
+ * Return: 1 if the current block has to be closed before @skb is placed,
+ * 0 if it fits, negative errno if it can't be sent.
+ */
 static int
-nfp_nfdk_tx_maybe_close_block(struct nfp_net_tx_ring *tx_ring,
-			      struct sk_buff *skb)
+nfp_nfdk_tx_block_check(struct nfp_net_tx_ring *tx_ring, struct sk_buff *skb)
 {
-	unsigned int n_descs, wr_p, nop_slots;
+	struct nfp_net_r_vector *r_vec = tx_ring->r_vec;
 	const skb_frag_t *frag, *fend;
-	struct nfp_nfdk_tx_desc *txd;
 	unsigned int nr_frags;
-	unsigned int wr_idx;
+	unsigned int n_descs;
+	bool pulled = false;
 	int err;
 
 recount_descs:
@@ -149,13 +203,29 @@ recount_descs:
 					NFDK_TX_MAX_DATA_PER_DESC);
 
 	if (unlikely(n_descs > NFDK_TX_DESC_GATHER_MAX)) {
-		if (skb_is_nonlinear(skb)) {
-			err = skb_linearize(skb);
-			if (err)
-				return err;
+		if (!skb_is_nonlinear(skb))
+			return -EINVAL;
+
+		/* Try copying only a few small frags first, linearizing
+		 * copies the entire (possibly 64kB TSO) packet.
+		 */
+		if (!pulled && !skb_has_frag_list(skb) &&
+		    !nfp_nfdk_tx_pull_frags(skb, n_descs)) {
+			u64_stats_update_begin(&r_vec->tx_sync);
+			r_vec->tx_frag_pull++;
+			u64_stats_update_end(&r_vec->tx_sync);
+			pulled = true;
 			goto recount_descs;
 		}
-		return -EINVAL;
+
+		err = skb_linearize(skb);
+		if (err)
+			return err;
+
+		u64_stats_update_begin(&r_vec->tx_sync);
+		r_vec->tx_linearize++;
+		u64_stats_update_end(&r_vec->tx_sync);
+		goto recount_descs;
 	}
 
 	/* Under count by 1 (don't count meta) for the round down to work out */
@@ -163,14 +233,21 @@ recount_descs:
 
 	if (round_down(tx_ring->wr_p, NFDK_TX_DESC_BLOCK_CNT) !=
 	    round_down(tx_ring->wr_p + n_descs, NFDK_TX_DESC_BLOCK_CNT))
-		goto close_block;
+		return 1;
 
 	if ((u32)tx_ring->data_pending + skb->len > NFDK_TX_MAX_DATA_PER_BLOCK)
-		goto close_block;
+		return 1;
 
 	return 0;
+}
+
+static void nfp_nfdk_tx_close_block(struct nfp_net_tx_ring *tx_ring)
+{
+	struct nfp_net_r_vector *r_vec = tx_ring->r_vec;
+	unsigned int wr_p, nop_slots;
+	struct nfp_nfdk_tx_desc *txd;
+	unsigned int wr_idx;
 
-close_block:
 	wr_p = tx_ring->wr_p;
 	nop_slots = D_BLOCK_CPL(wr_p);
 
@@ -184,6 +261,24 @@ close_block:
 	tx_ring->wr_p += nop_slots;
 	tx_ring->wr_ptr_add += nop_slots;
 
+	u64_stats_update_begin(&r_vec->tx_sync);
+	r_vec->tx_block_close++;
+	r_vec->tx_nop_slots += nop_slots;
+	u64_stats_update_end(&r_vec->tx_sync);
+}
+
+static int
+nfp_nfdk_tx_maybe_close_block(struct nfp_net_tx_ring *tx_ring,
+			      struct sk_buff *skb)
+{
+	int err;
+
+	err = nfp_nfdk_tx_block_check(tx_ring, skb);
+	if (err <= 0)
+		return err;
+
+	nfp_nfdk_tx_close_block(tx_ring);
+
 	return 0;
 }
 
@@ -271,60 +366,32 @@ nfp_nfdk_prep_tx_meta(struct nfp_net_dp *dp, struct nfp_app *app,
 }
 
 /**
- * nfp_nfdk_tx() - Main transmit entry point
- * @skb:    SKB to transmit
- * @netdev: netdev structure
+ * nfp_nfdk_tx_write() - place a packet on the TX ring
+ * @dp:		NFP Net data path struct
+ * @tx_ring:	TX ring structure
+ * @skb:	packet to send, must fit in the current block
+ * @metadata:	TX metadata prepared for @skb
+ * @ipsec:	@skb is to be encrypted by the IPsec offload
+ * @real_len:	number of bytes which will be put on the wire (output param)
  *
- * Return: NETDEV_TX_OK on success.
+ * Return: 0 on success, negative errno if @skb could not be mapped.
  */
-netdev_tx_t nfp_nfdk_tx(struct sk_buff *skb, struct net_device *netdev)
+static int
+nfp_nfdk_tx_write(struct nfp_net_dp *dp, struct nfp_net_tx_ring *tx_ring,
+		  struct sk_buff *skb, u64 metadata, bool ipsec,
+		  unsigned int *real_len)
 {
-	struct nfp_net *nn = netdev_priv(netdev);
+	struct nfp_net_r_vector *r_vec = tx_ring->r_vec;
 	struct nfp_nfdk_tx_buf *txbuf, *etxbuf;
 	u32 cnt, tmp_dlen, dlen_type = 0;
-	struct nfp_net_tx_ring *tx_ring;
-	struct nfp_net_r_vector *r_vec;
 	const skb_frag_t *frag, *fend;
 	struct nfp_nfdk_tx_desc *txd;
-	unsigned int real_len, qidx;
 	unsigned int dma_len, type;
-	struct netdev_queue *nd_q;
-	struct nfp_net_dp *dp;
 	int nr_frags, wr_idx;
 	dma_addr_t dma_addr;
-	bool ipsec = false;
-	u64 metadata;
-
-	dp = &nn->dp;
-	qidx = skb_get_queue_mapping(skb);
-	tx_ring = &dp->tx_rings[qidx];
-	r_vec = tx_ring->r_vec;
-	nd_q = netdev_get_tx_queue(dp->netdev, qidx);
-
-	/* Don't bother counting frags, assume the worst */
-	if (unlikely(nfp_net_tx_full(tx_ring, NFDK_TX_DESC_STOP_CNT))) {
-		nn_dp_warn(dp, "TX ring %d busy. wrp=%u rdp=%u\n",
-			   qidx, tx_ring->wr_p, tx_ring->rd_p);
-		netif_tx_stop_queue(nd_q);
-		nfp_net_tx_xmit_more_flush(tx_ring);
-		u64_stats_update_begin(&r_vec->tx_sync);
-		r_vec->tx_busy++;
-		u64_stats_update_end(&r_vec->tx_sync);
-		return NETDEV_TX_BUSY;
-	}
-
-	metadata = nfp_nfdk_prep_tx_meta(dp, nn->app, skb, &ipsec);
-	if (unlikely((int)metadata < 0))
-		goto err_flush;
-
-	if (unlikely(compat_ndo_features_check(nn, skb)))
-		goto err_flush;
-
-	if (nfp_nfdk_tx_maybe_close_block(tx_ring, skb))
-		goto err_flush;
 
 	/* nr_frags will change after skb_linearize so we get nr_frags after
-	 * nfp_nfdk_tx_maybe_close_block function
+	 * nfp_nfdk_tx_block_check function
 	 */
 	nr_frags = skb_shinfo(skb)->nr_frags;
 	/* DMA map all */
@@ -340,9 +407,16 @@ netdev_tx_t nfp_nfdk_tx(struct sk_buff *skb, struct net_device *netdev)
 	else
 		type = NFDK_DESC_TX_TYPE_GATHER;
 
-	dma_addr = dma_map_single(dp->dev, skb->data, dma_len, DMA_TO_DEVICE);
-	if (dma_mapping_error(dp->dev, dma_addr))
-		goto err_warn_dma;
+	if (nfp_net_tx_can_copybreak(tx_ring, skb)) {
+		/* Every packet takes at least two descriptors */
+		dma_addr = nfp_net_tx_copybreak(tx_ring, skb,
+						wr_idx / NFDK_TX_DESC_PER_SIMPLE_PKT);
+	} else {
+		dma_addr = dma_map_single(dp->dev, skb->data, dma_len,
+					  DMA_TO_DEVICE);
+		if (dma_mapping_error(dp->dev, dma_addr))
+			goto err_warn_dma;
+	}
 
 	txbuf->skb = skb;
 	txbuf++;
@@ -418,7 +492,7 @@ netdev_tx_t nfp_nfdk_tx(struct sk_buff *skb, struct net_device *netdev)
 		metadata = nfp_nfdk_ipsec_tx(metadata, skb);
 
 	if (!skb_is_gso(skb)) {
-		real_len = skb->len;
+		*real_len = skb->len;
 		/* Metadata desc */
 		if (!ipsec)
 			metadata = nfp_nfdk_tx_csum(dp, r_vec, 1, skb, metadata);
@@ -427,7 +501,7 @@ netdev_tx_t nfp_nfdk_tx(struct sk_buff *skb, struct net_device *netdev)
 	} else {
 		/* lso desc should be placed after metadata desc */
 		(txd + 1)->raw = nfp_nfdk_tx_tso(r_vec, txbuf, skb);
-		real_len = txbuf->real_len;
+		*real_len = txbuf->real_len;
 		/* Metadata desc */
 		if (!ipsec)
 			metadata = nfp_nfdk_tx_csum(dp, r_vec, txbuf->pkt_cnt, skb, metadata);
@@ -449,14 +523,9 @@ netdev_tx_t nfp_nfdk_tx(struct sk_buff *skb, struct net_device *netdev)
 	else
 		tx_ring->data_pending = 0;
 
-	if (nfp_nfdk_tx_ring_should_stop(tx_ring))
-		nfp_nfdk_tx_ring_stop(nd_q, tx_ring);
-
 	tx_ring->wr_ptr_add += cnt;
-	if (__netdev_tx_sent_queue(nd_q, real_len, skb_xmit_more(skb)))
-		nfp_net_tx_xmit_more_flush(tx_ring);
 
-	return NETDEV_TX_OK;
+	return 0;
 
 err_warn_overflow:
 	WARN_ONCE(1, "unable to fit packet into a descriptor wr_idx:%d head:%d frags:%d cnt:%d",
@@ -469,8 +538,9 @@ err_unmap:
 	/* first txbuf holds the skb */
 	txbuf = &tx_ring->ktxbufs[wr_idx + 1];
 	if (txbuf < etxbuf) {
-		dma_unmap_single(dp->dev, txbuf->dma_addr,
-				 skb_headlen(skb), DMA_TO_DEVICE);
+		if (!nfp_net_tx_is_copybreak(tx_ring, txbuf->dma_addr))
+			dma_unmap_single(dp->dev, txbuf->dma_addr,
+					 skb_headlen(skb), DMA_TO_DEVICE);
 		txbuf->raw = 0;
 		txbuf++;
 	}
@@ -484,7 +554,164 @@ err_unmap:
 	}
 err_warn_dma:
 	nn_dp_warn(dp, "Failed to map DMA TX buffer\n");
+	return -ENOMEM;
+}
+
+/**
+ * nfp_nfdk_tx_may_pass() - check if a packet may be sent ahead of another
+ * @held:	packet waiting for the next block
+ * @skb:	packet which would fill the current block
+ *
+ * Only packets known to belong to different flows may be reordered.  The
+ * flow hash can't tell: a socket may pick a new TX hash at any time (see
+ * sk_rethink_txhash()) and forwarded packets of one flow may carry hashes
+ * computed by different ingress devices.  Only local packets of different
+ * sockets are therefore allowed to pass each other.
+ */
+static bool
+nfp_nfdk_tx_may_pass(const struct sk_buff *held, const struct sk_buff *skb)
+{
+	return skb->sk && held->sk && skb->sk != held->sk;
+}
+
+static bool nfp_nfdk_tx_can_hold(struct nfp_net_tx_ring *tx_ring)
+{
+	/* Keep enough space for the held packet whatever fills the block */
+	return !nfp_net_tx_full(tx_ring, NFDK_TX_DESC_STOP_CNT * 2) &&
+	       D_BLOCK_CPL(tx_ring->wr_p) >= NFDK_TX_DESC_PER_SIMPLE_PKT;
+}
+
+/**
+ * nfp_nfdk_tx_write_held() - place the held packet on the TX ring
+ * @dp:		NFP Net data path struct
+ * @tx_ring:	TX ring structure
+ * @nd_q:	netdev TX queue of @tx_ring
+ */
+static void
+nfp_nfdk_tx_write_held(struct nfp_net_dp *dp, struct nfp_net_tx_ring *tx_ring,
+		       struct netdev_queue *nd_q)
+{
+	struct nfp_net_r_vector *r_vec = tx_ring->r_vec;
+	struct sk_buff *skb = tx_ring->held_skb;
+	unsigned int real_len;
+	int err;
+
+	tx_ring->held_skb = NULL;
+
+	err = nfp_nfdk_tx_maybe_close_block(tx_ring, skb);
+	if (!err)
+		err = nfp_nfdk_tx_write(dp, tx_ring, skb, tx_ring->held_meta,
+					tx_ring->held_ipsec, &real_len);
+	if (err) {
+		u64_stats_update_begin(&r_vec->tx_sync);
+		r_vec->tx_errors++;
+		u64_stats_update_end(&r_vec->tx_sync);
+		dev_kfree_skb_any(skb);
+		return;
+	}
+
+	netdev_tx_sent_queue(nd_q, real_len);
+	if (nfp_nfdk_tx_ring_should_stop(tx_ring))
+		nfp_nfdk_tx_ring_stop(nd_q, tx_ring);
+}
+
+/**
+ * nfp_nfdk_tx() - Main transmit entry point
+ * @skb:    SKB to transmit
+ * @netdev: netdev structure
+ *
+ * A packet which would force the current block to be closed with NOPs may,
+ * if nfdk_tx_pack is set and more packets are coming, be held back until
+ * the following packets of other flows have filled the block.
+ *
+ * Return: NETDEV_TX_OK on success.
+ */
+netdev_tx_t nfp_nfdk_tx(struct sk_buff *skb, struct net_device *netdev)
+{
+	struct nfp_net *nn = netdev_priv(netdev);
+	struct nfp_net_tx_ring *tx_ring;
+	struct nfp_net_r_vector *r_vec;
+	unsigned int real_len, qidx;
+	struct netdev_queue *nd_q;
+	struct nfp_net_dp *dp;
+	bool ipsec = false;
+	u64 metadata;
+	bool more;
+	int err;
+
+	dp = &nn->dp;
+	qidx = skb_get_queue_mapping(skb);
+	tx_ring = &dp->tx_rings[qidx];
+	r_vec = tx_ring->r_vec;
+	nd_q = netdev_get_tx_queue(dp->netdev, qidx);
+
+	/* Don't bother counting frags, assume the worst */
+	if (unlikely(nfp_net_tx_full(tx_ring, NFDK_TX_DESC_STOP_CNT))) {
+		nn_dp_warn(dp, "TX ring %d busy. wrp=%u rdp=%u\n",
+			   qidx, tx_ring->wr_p, tx_ring->rd_p);
+		netif_tx_stop_queue(nd_q);
+		nfp_net_tx_xmit_more_flush(tx_ring);
+		u64_stats_update_begin(&r_vec->tx_sync);
+		r_vec->tx_busy++;
+		u64_stats_update_end(&r_vec->tx_sync);
+		return NETDEV_TX_BUSY;
+	}
+
+	metadata = nfp_nfdk_prep_tx_meta(dp, nn->app, skb, &ipsec);
+	if (unlikely((int)metadata < 0))
+		goto err_flush;
+
+	if (unlikely(compat_ndo_features_check(nn, skb)))
+		goto err_flush;
+
+	err = nfp_nfdk_tx_block_check(tx_ring, skb);
+	if (err < 0)
+		goto err_flush;
+
+	more = skb_xmit_more(skb);
+	if (tx_ring->held_skb) {
+		if (err || !nfp_nfdk_tx_may_pass(tx_ring->held_skb, skb)) {
+			nfp_nfdk_tx_write_held(dp, tx_ring, nd_q);
+			err = nfp_nfdk_tx_block_check(tx_ring, skb);
+			if (err < 0)
+				goto err_flush;
+		} else {
+			u64_stats_update_begin(&r_vec->tx_sync);
+			r_vec->tx_block_fill++;
+			u64_stats_update_end(&r_vec->tx_sync);
+		}
+	} else if (err && nfdk_tx_pack && more &&
+		   nfp_nfdk_tx_can_hold(tx_ring)) {
+		tx_ring->held_skb = skb;
+		tx_ring->held_meta = metadata;
+		tx_ring->held_ipsec = ipsec;
+		return NETDEV_TX_OK;
+	}
+
+	if (err)
+		nfp_nfdk_tx_close_block(tx_ring);
+
+	if (nfp_nfdk_tx_write(dp, tx_ring, skb, metadata, ipsec, &real_len))
+		goto err_flush;
+
+	if (tx_ring->held_skb && !more)
+		nfp_nfdk_tx_write_held(dp, tx_ring, nd_q);
+
+	if (nfp_nfdk_tx_ring_should_stop(tx_ring))
+		nfp_nfdk_tx_ring_stop(nd_q, tx_ring);
+
+	if (__netdev_tx_sent_queue(nd_q, real_len, more)) {
+		/* The stack may not call us again, don't strand the held skb */
+		if (tx_ring->held_skb)
+			nfp_nfdk_tx_write_held(dp, tx_ring, nd_q);
+		nfp_net_tx_xmit_more_flush(tx_ring);
+	}
+
+	return NETDEV_TX_OK;
+
 err_flush:
+	if (tx_ring->held_skb)
+		nfp_nfdk_tx_write_held(dp, tx_ring, nd_q);
 	nfp_net_tx_xmit_more_flush(tx_ring);
 	u64_stats_update_begin(&r_vec->tx_sync);
 	r_vec->tx_errors++;
@@ -541,7 +768,9 @@ static void nfp_nfdk_tx_complete(struct nfp_net_tx_ring *tx_ring, int budget)
 		/* Unmap head */
 		size = skb_headlen(skb);
 		n_descs += nfp_nfdk_headlen_to_segs(size);
-		dma_unmap_single(dev, txbuf->dma_addr, size, DMA_TO_DEVICE);
+		if (!nfp_net_tx_is_copybreak(tx_ring, txbuf->dma_addr))
+			dma_unmap_single(dev, txbuf->dma_addr, size,
+					 DMA_TO_DEVICE);
 		txbuf++;
 
 		/* Unmap frags */
@@ -579,6 +808,8 @@ next:
 	r_vec->tx_pkts += done_pkts;
 	u64_stats_update_end(&r_vec->tx_sync);
 
+	nfp_net_ring_stats_tx_done(tx_ring, done_pkts);
+
 	if (!dp->netdev)
 		return;
 
@@ -748,6 +979,102 @@ nfp_nfdk_rx_csum(struct nfp_net_dp *dp, struct nfp_net_r_vector *r_vec,
 	}
 }
 
+/**
+ * nfp_nfdk_rx_gro_hw() - set up GSO info of a frame coalesced by the firmware
+ * @r_vec: per-ring structure
+ * @skb: Pointer to SKB, data pointing at the L3 header or in-band VLAN tags
+ * @meta: Parsed metadata prepend
+ *
+ * Make the frame look like one built by software GRO, so that it can be
+ * resegmented if it gets forwarded.  The firmware only coalesces TCP
+ * segments with valid checksums and fixes up the IP length fields, the
+ * TCP checksum is replaced with the pseudo header one.  Frames whose TCP
+ * header can't be found are passed up as they are and counted.
+ */
+static void
+nfp_nfdk_rx_gro_hw(struct nfp_net_r_vector *r_vec, struct sk_buff *skb,
+		   const struct nfp_meta_parsed *meta)
+{
+	unsigned int nhoff = 0, thoff, gso_type;
+	__be16 proto = skb->protocol;
+	struct ipv6hdr *ip6h;
+	struct iphdr *iph;
+	struct tcphdr *th;
+	__be16 frag_off;
+	u8 nexthdr;
+	int off;
+
+	/* VLAN tags the FW did not strip, C-tag or S-tag + C-tag */
+	while (proto == htons(ETH_P_8021Q) || proto == htons(ETH_P_8021AD)) {
+		if (!pskb_may_pull(skb, nhoff + VLAN_HLEN))
+			goto err_miss;
+		proto = ((struct vlan_hdr *)(skb->data + nhoff))->
+			h_vlan_encapsulated_proto;
+		nhoff += VLAN_HLEN;
+	}
+
+	switch (proto) {
+	case htons(ETH_P_IP):
+		if (!pskb_may_pull(skb, nhoff + sizeof(*iph)))
+			goto err_miss;
+		iph = (struct iphdr *)(skb->data + nhoff);
+		if (iph->protocol != IPPROTO_TCP)
+			goto err_miss;
+		thoff = nhoff + iph->ihl * 4;
+		gso_type = SKB_GSO_TCPV4;
+		break;
+	case htons(ETH_P_IPV6):
+		if (!pskb_may_pull(skb, nhoff + sizeof(*ip6h)))
+			goto err_miss;
+		ip6h = (struct ipv6hdr *)(skb->data + nhoff);
+		nexthdr = ip6h->nexthdr;
+		off = ipv6_skip_exthdr(skb, nhoff + sizeof(*ip6h), &nexthdr,
+				       &frag_off);
+		if (off < 0 || nexthdr != IPPROTO_TCP || frag_off)
+			goto err_miss;
+		thoff = off;
+		gso_type = SKB_GSO_TCPV6;
+		break;
+	default:
+		goto err_miss;
+	}
+
+	if (!pskb_may_pull(skb, thoff + sizeof(*th)))
+		goto err_miss;
+	th = (struct tcphdr *)(skb->data + thoff);
+	if (gso_type == SKB_GSO_TCPV4) {
+		iph = (struct iphdr *)(skb->data + nhoff);
+		th->check = ~tcp_v4_check(skb->len - thoff, iph->saddr,
+					  iph->daddr, 0);
+	} else {
+		ip6h = (struct ipv6hdr *)(skb->data + nhoff);
+		th->check = ~tcp_v6_check(skb->len - thoff, &ip6h->saddr,
+					  &ip6h->daddr, 0);
+	}
+
+	skb_set_network_header(skb, nhoff);
+	skb_set_transport_header(skb, thoff);
+
+	skb->ip_summed = CHECKSUM_PARTIAL;
+	skb->csum_start = skb_transport_header(skb) - skb->head;
+	skb->csum_offset = offsetof(struct tcphdr, check);
+
+	skb_shinfo(skb)->gso_size = meta->gro.mss;
+	skb_shinfo(skb)->gso_segs = meta->gro.segs;
+	skb_shinfo(skb)->gso_type = gso_type;
+
+	u64_stats_update_begin(&r_vec->rx_sync);
+	r_vec->hw_gro_rx++;
+	r_vec->hw_gro_rx_segs += meta->gro.segs;
+	u64_stats_update_end(&r_vec->rx_sync);
+	return;
+
+err_miss:
+	u64_stats_update_begin(&r_vec->rx_sync);
+	r_vec->hw_gro_rx_miss++;
+	u64_stats_update_end(&r_vec->rx_sync);
+}
+
 static void
 nfp_nfdk_set_hash(struct net_device *netdev, struct nfp_meta_parsed *meta,
 		  unsigned int type, __be32 *hash)
@@ -769,11 +1096,55 @@ nfp_nfdk_set_hash(struct net_device *netdev, struct nfp_meta_parsed *meta,
 	meta->hash = get_unaligned_be32(hash);
 }
 
+/**
+ * nfp_nfdk_parse_meta_fast() - Parse the common hash (and mark) only metadata
+ * @netdev: netdev structure
+ * @meta: Parsed metadata output
+ * @data: Metadata prepend
+ * @meta_len: Length of the metadata prepend
+ *
+ * With RSS on, most packets carry just the hash, possibly followed by a mark
+ * from the BPF offload.  Recognize those layouts with a single compare of
+ * the field list instead of walking it.
+ *
+ * Return: true if the metadata was parsed, false if the generic parser
+ * has to be used.
+ */
+static bool
+nfp_nfdk_parse_meta_fast(struct net_device *netdev,
+			 struct nfp_meta_parsed *meta, void *data,
+			 int meta_len)
+{
+	u32 meta_info;
+
+	meta_info = get_unaligned_be32(data);
+
+	switch (meta_info & ~NFP_NET_META_HASH_TYPE_MASK) {
+	case NFP_NET_META_HASH:
+		if (meta_len != 8)
+			return false;
+		break;
+	case NFP_NET_META_HASH |
+	     NFP_NET_META_MARK << (2 * NFP_NET_META_FIELD_SIZE):
+		if (meta_len != 12)
+			return false;
+		meta->mark = get_unaligned_be32(data + 8);
+		break;
+	default:
+		return false;
+	}
+
+	nfp_nfdk_set_hash(netdev, meta,
+			  FIELD_GET(NFP_NET_META_HASH_TYPE_MASK, meta_info),
+			  (__be32 *)(data + 4));
+	return true;
+}
+
 static bool
 nfp_nfdk_parse_meta(struct net_device *netdev, struct nfp_meta_parsed *meta,
 		    void *data, void *pkt, unsigned int pkt_len, int meta_len)
 {
-	u32 meta_info, vlan_info;
+	u32 meta_info, vlan_info, gro_info;
 
 	meta_info = get_unaligned_be32(data);
 	data += 4;
@@ -827,6 +1198,14 @@ nfp_nfdk_parse_meta(struct net_device *netdev, struct nfp_meta_parsed *meta,
 			data += 4;
 			break;
 #endif
+		case NFP_NET_META_GRO_HW:
+			gro_info = get_unaligned_be32(data);
+			meta->gro.segs = FIELD_GET(NFP_NET_META_GRO_SEGS_MASK,
+						   gro_info);
+			meta->gro.mss = FIELD_GET(NFP_NET_META_GRO_MSS_MASK,
+						  gro_info);
+			data += 4;
+			break;
 		default:
 			return true;
 		}
@@ -837,6 +1216,19 @@ nfp_nfdk_parse_meta(struct net_device *netdev, struct nfp_meta_parsed *meta,
 	return data != pkt;
 }
 
+static bool
+nfp_nfdk_rx_parse_meta(const struct nfp_net_dp *dp,
+		       struct nfp_meta_parsed *meta, void *data, void *pkt,
+		       unsigned int pkt_len, int meta_len)
+{
+	if (dp->rx_meta_fast &&
+	    nfp_nfdk_parse_meta_fast(dp->netdev, meta, data, meta_len))
+		return false;
+
+	return nfp_nfdk_parse_meta(dp->netdev, meta, data, pkt, pkt_len,
+				   meta_len);
+}
+
 static void
 nfp_nfdk_rx_drop(const struct nfp_net_dp *dp, struct nfp_net_r_vector *r_vec,
 		 struct nfp_net_rx_ring *rx_ring, struct nfp_net_rx_buf *rxbuf,
@@ -1151,10 +1543,10 @@ static int nfp_nfdk_rx(struct nfp_net_rx_ring *rx_ring, int budget)
 					data_len);
 
 		if (meta_len) {
-			if (unlikely(nfp_nfdk_parse_meta(dp->netdev, &meta,
-							 rxbuf->frag + meta_off,
-							 rxbuf->frag + pkt_off,
-							 pkt_len, meta_len))) {
+			if (unlikely(nfp_nfdk_rx_parse_meta(dp, &meta,
+							    rxbuf->frag + meta_off,
+							    rxbuf->frag + pkt_off,
+							    pkt_len, meta_len))) {
 				nn_dp_warn(dp, "invalid RX packet metadata\n");
 				nfp_nfdk_rx_drop(dp, r_vec, rx_ring, rxbuf,
 						 NULL);
@@ -1278,6 +1670,9 @@ static int nfp_nfdk_rx(struct nfp_net_rx_ring *rx_ring, int budget)
 			continue;
 		}
 
+		if (meta.gro.segs > 1 && meta.gro.mss)
+			nfp_nfdk_rx_gro_hw(r_vec, skb, &meta);
+
 #ifdef CONFIG_NFP_NET_IPSEC
 		if (meta.ipsec_saidx != 0 && unlikely(nfp_net_ipsec_rx(&meta, skb))) {
 			nfp_nfdk_rx_drop(dp, r_vec, rx_ring, NULL, skb);
@@ -1331,9 +1726,10 @@ int nfp_nfdk_poll(struct napi_struct *napi, int budget)
 	if (r_vec->rx_ring)
 		pkts_polled = nfp_nfdk_rx(r_vec->rx_ring, budget);
 
+	nfp_net_ring_stats_poll(r_vec, pkts_polled, budget);
+
 	if (pkts_polled < budget)
-		if (napi_complete_done(napi, pkts_polled))
-			nfp_net_irq_unmask(r_vec->nfp_net, r_vec->irq_entry);
+		nfp_net_napi_complete(r_vec, pkts_polled);
 
 #ifdef COMPAT_HAVE_DIM
 	if (r_vec->nfp_net->rx_coalesce_adapt_on && r_vec->rx_ring) {
@@ -18,6 +18,7 @@
 					 NFDK_TX_DESC_PER_SIMPLE_PKT)
 #define NFDK_TX_MAX_DATA_PER_BLOCK	SZ_64K
 #define NFDK_TX_DESC_GATHER_MAX		17
+#define NFDK_TX_MAX_PULL		SZ_16K
 
 /* TX descriptor format */
 
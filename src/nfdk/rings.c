@@ -36,7 +36,9 @@ nfp_nfdk_tx_ring_reset(struct nfp_net_dp *dp, struct nfp_net_tx_ring *tx_ring)
 
 		/* Unmap head */
 		size = skb_headlen(skb);
-		dma_unmap_single(dev, txbuf->dma_addr, size, DMA_TO_DEVICE);
+		if (!nfp_net_tx_is_copybreak(tx_ring, txbuf->dma_addr))
+			dma_unmap_single(dev, txbuf->dma_addr, size,
+					 DMA_TO_DEVICE);
 		n_descs += nfp_nfdk_headlen_to_segs(size);
 		txbuf++;
 
@@ -59,6 +61,11 @@ next:
 		tx_ring->rd_p += n_descs;
 	}
 
+	if (tx_ring->held_skb) {
+		dev_kfree_skb_any(tx_ring->held_skb);
+		tx_ring->held_skb = NULL;
+	}
+
 	memset(tx_ring->txds, 0, tx_ring->size);
 	tx_ring->data_pending = 0;
 	tx_ring->wr_p = 0;
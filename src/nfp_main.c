@@ -10,10 +10,13 @@
  */
 #include "nfpcore/kcompat.h"
 
+#include <linux/crc32.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/pci.h>
+#include <linux/sizes.h>
 #include <linux/firmware.h>
 #include <linux/vmalloc.h>
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 6, 0)
@@ -75,6 +78,10 @@ bool force_40b_dma;
 module_param(force_40b_dma, bool, 0444);
 MODULE_PARM_DESC(force_40b_dma, "Force using 40b dma mask, which allows new HW to use NFD3 firmware (default = false)");
 
+static bool nfp_fw_keep_loaded;
+module_param(nfp_fw_keep_loaded, bool, 0444);
+MODULE_PARM_DESC(nfp_fw_keep_loaded, "Leave firmware loaded on driver removal, so that reloading the driver with the same image skips reset and load (default = false)");
+
 static const char nfp_driver_name[] = "nfp";
 const char nfp_driver_version[] = NFP_SRC_VERSION;
 
@@ -227,6 +234,30 @@ int nfp_mbox_cmd(struct nfp_pf *pf, u32 cmd, void *in_data, u64 in_length,
 	return out_length;
 }
 
+/* Board state poll interval, backs off from MIN to MAX */
+#define NFP_BOARD_STATE_POLL_MIN_MS	20U
+#define NFP_BOARD_STATE_POLL_MAX_MS	500U
+
+/**
+ * nfp_probe_trace() - log duration of a probe phase
+ * @pdev:	PCI Device structure
+ * @phase:	name of the phase which just finished
+ * @start:	start time of the phase, updated to the current time
+ *
+ * Probe of multiple devices may run in parallel, per-phase timings make it
+ * possible to tell which device and which phase holds up the boot.
+ * Enable with dynamic debug.
+ */
+static void
+nfp_probe_trace(struct pci_dev *pdev, const char *phase, ktime_t *start)
+{
+	ktime_t now = ktime_get();
+
+	dev_dbg(&pdev->dev, "probe: %s took %lld ms\n",
+		phase, ktime_to_ms(ktime_sub(now, *start)));
+	*start = now;
+}
+
 static bool nfp_board_ready(struct nfp_pf *pf)
 {
 	const char *cp;
@@ -247,6 +278,7 @@ static bool nfp_board_ready(struct nfp_pf *pf)
 static int nfp_pf_board_state_wait(struct nfp_pf *pf)
 {
 	const unsigned long wait_until = jiffies + 10 * HZ;
+	unsigned int delay_ms = NFP_BOARD_STATE_POLL_MIN_MS;
 
 	while (!nfp_board_ready(pf)) {
 		if (time_is_before_eq_jiffies(wait_until)) {
@@ -254,9 +286,11 @@ static int nfp_pf_board_state_wait(struct nfp_pf *pf)
 			return -EINVAL;
 		}
 
-		nfp_info(pf->cpp, "waiting for board initialization\n");
-		if (msleep_interruptible(500))
+		if (delay_ms == NFP_BOARD_STATE_POLL_MIN_MS)
+			nfp_info(pf->cpp, "waiting for board initialization\n");
+		if (msleep_interruptible(delay_ms))
 			return -ERESTARTSYS;
+		delay_ms = min(delay_ms * 2, NFP_BOARD_STATE_POLL_MAX_MS);
 
 		/* Refresh cached information */
 		kfree(pf->hwinfo);
@@ -639,6 +673,83 @@ nfp_get_fw_policy_value(struct pci_dev *pdev, struct nfp_nsp *nsp,
 	return err;
 }
 
+#define NFP_FW_DIGEST_KEY	"drv_fw_digest"
+
+/* Digest identifying a firmware image, "<crc32>-<size>" */
+static void
+nfp_fw_digest(const struct firmware *fw, char *buf, unsigned int size)
+{
+	snprintf(buf, size, "%08x-%zx",
+		 ~crc32_le(~0, fw->data, fw->size), fw->size);
+}
+
+/**
+ * nfp_fw_digest_match() - check if @fw is the image already running
+ * @pdev:	PCI Device structure
+ * @nsp:	NFP SP handle
+ * @fw:		firmware image selected for load
+ *
+ * The driver records the digest of the image it loaded in HWinfo and
+ * clears it whenever it resets the NFP or lets another image be loaded,
+ * see nfp_fw_digest_clear().
+ *
+ * Return: true if firmware is loaded and its digest matches @fw.
+ */
+static bool
+nfp_fw_digest_match(struct pci_dev *pdev, struct nfp_nsp *nsp,
+		    const struct firmware *fw)
+{
+	char digest[32], hwinfo[64];
+
+	if (!nfp_nsp_has_hwinfo_set(nsp) ||
+	    !nfp_nsp_has_fw_loaded(nsp) || !nfp_nsp_fw_loaded(nsp))
+		return false;
+
+	snprintf(hwinfo, sizeof(hwinfo), NFP_FW_DIGEST_KEY);
+	if (nfp_nsp_hwinfo_lookup_optional(nsp, hwinfo, sizeof(hwinfo), ""))
+		return false;
+
+	nfp_fw_digest(fw, digest, sizeof(digest));
+	if (strcmp(hwinfo, digest))
+		return false;
+
+	dev_info(&pdev->dev, "Firmware image %s already loaded, skipping reset and load\n",
+		 digest);
+	return true;
+}
+
+static void
+nfp_fw_digest_store(struct pci_dev *pdev, struct nfp_nsp *nsp,
+		    const struct firmware *fw)
+{
+	char digest[32], hwinfo[64];
+	int err;
+
+	if (!nfp_nsp_has_hwinfo_set(nsp))
+		return;
+
+	nfp_fw_digest(fw, digest, sizeof(digest));
+	snprintf(hwinfo, sizeof(hwinfo), NFP_FW_DIGEST_KEY "=%s", digest);
+	err = nfp_nsp_hwinfo_set(nsp, hwinfo, sizeof(hwinfo));
+	if (err)
+		dev_warn(&pdev->dev, "Failed to record FW digest: %d\n", err);
+}
+
+/* Forget the digest, the running firmware is no longer known to be ours */
+static void nfp_fw_digest_clear(struct pci_dev *pdev, struct nfp_nsp *nsp)
+{
+	char hwinfo[64];
+	int err;
+
+	if (!nfp_nsp_has_hwinfo_set(nsp))
+		return;
+
+	snprintf(hwinfo, sizeof(hwinfo), NFP_FW_DIGEST_KEY "=");
+	err = nfp_nsp_hwinfo_set(nsp, hwinfo, sizeof(hwinfo));
+	if (err)
+		dev_warn(&pdev->dev, "Failed to clear FW digest: %d\n", err);
+}
+
 /**
  * nfp_fw_load() - Load the firmware image
  * @pdev:       PCI Device structure
@@ -656,6 +767,8 @@ nfp_fw_load(struct pci_dev *pdev, struct nfp_pf *pf, struct nfp_nsp *nsp)
 	char *token, *ptr;
 	char hwinfo[64];
 	u16 interface;
+	ktime_t start;
+	s64 load_ms;
 
 	snprintf(hwinfo, sizeof(hwinfo), "abi_drv_load_ifc");
 	err = nfp_nsp_hwinfo_lookup_optional(nsp, hwinfo, sizeof(hwinfo),
@@ -682,6 +795,8 @@ nfp_fw_load(struct pci_dev *pdev, struct nfp_pf *pf, struct nfp_nsp *nsp)
 	}
 
 	if (!token) {
+		/* The partner may load any image, don't trust our digest */
+		nfp_fw_digest_clear(pdev, nsp);
 		dev_info(&pdev->dev, "Firmware will be loaded by partner\n");
 		return 0;
 	}
@@ -698,7 +813,19 @@ nfp_fw_load(struct pci_dev *pdev, struct nfp_pf *pf, struct nfp_nsp *nsp)
 	if (err)
 		return err;
 
+	start = ktime_get();
 	fw = nfp_net_fw_find(pdev, pf);
+	nfp_probe_trace(pdev, "nfp_net_fw_find", &start);
+
+	/* Only short-cut when the reset policy would keep the firmware anyway */
+	if (fw && nfp_fw_keep_loaded && policy != NFP_NSP_APP_FW_LOAD_FLASH &&
+	    (reset == NFP_NSP_DRV_RESET_NEVER ||
+	     reset == NFP_NSP_DRV_RESET_DISK) &&
+	    nfp_fw_digest_match(pdev, nsp, fw)) {
+		fw_loaded = true;
+		goto exit_release_fw;
+	}
+
 	do_reset = reset == NFP_NSP_DRV_RESET_ALWAYS ||
 		   (fw && reset == NFP_NSP_DRV_RESET_DISK);
 
@@ -710,25 +837,35 @@ nfp_fw_load(struct pci_dev *pdev, struct nfp_pf *pf, struct nfp_nsp *nsp)
 				"Failed to soft reset the NFP: %d\n", err);
 			goto exit_release_fw;
 		}
+		nfp_fw_digest_clear(pdev, nsp);
 	}
 
 	if (fw && policy != NFP_NSP_APP_FW_LOAD_FLASH) {
 		if (nfp_nsp_has_fw_loaded(nsp) && nfp_nsp_fw_loaded(nsp))
 			goto exit_release_fw;
 
+		start = ktime_get();
 		err = nfp_nsp_load_fw(nsp, fw);
 		if (err < 0) {
 			dev_err(&pdev->dev, "FW loading failed: %d\n",
 				err);
 			goto exit_release_fw;
 		}
-		dev_info(&pdev->dev, "Finished loading FW image\n");
+		load_ms = ktime_to_ms(ktime_sub(ktime_get(), start));
+		nfp_probe_trace(pdev, "nfp_nsp_load_fw", &start);
+		nfp_fw_digest_store(pdev, nsp, fw);
+		dev_info(&pdev->dev,
+			 "Finished loading FW image, %zu kB in %lld ms (%llu kB/s)\n",
+			 fw->size / SZ_1K, load_ms,
+			 div64_u64((u64)fw->size * MSEC_PER_SEC / SZ_1K,
+				   max_t(s64, load_ms, 1)));
 		fw_loaded = true;
 	} else if (policy != NFP_NSP_APP_FW_LOAD_DISK &&
 		   nfp_nsp_has_stored_fw_load(nsp)) {
 		/* Don't propagate this error to stick with legacy driver
 		 * behavior, failure will be detected later during init.
 		 */
+		nfp_fw_digest_clear(pdev, nsp);
 		if (!nfp_nsp_load_stored_fw(nsp))
 			dev_info(&pdev->dev, "Finished loading stored FW image\n");
 
@@ -840,6 +977,7 @@ static void nfp_fw_unload(struct nfp_pf *pf)
 		dev_warn(&pf->pdev->dev, "Couldn't unload firmware: %d\n", err);
 	else
 		dev_info(&pf->pdev->dev, "Firmware safely unloaded\n");
+	nfp_fw_digest_clear(pf->pdev, nsp);
 
 	nfp_nsp_close(nsp);
 }
@@ -944,10 +1082,14 @@ static int nfp_pci_probe(struct pci_dev *pdev,
 			 const struct pci_device_id *pci_id)
 {
 	const struct nfp_dev_info *dev_info;
+	ktime_t probe_start, start;
 	struct devlink *devlink;
 	struct nfp_pf *pf;
 	int err, irq;
 
+	probe_start = ktime_get();
+	start = probe_start;
+
 	if ((pdev->vendor == PCI_VENDOR_ID_NETRONOME ||
 	     pdev->vendor == PCI_VENDOR_ID_CORIGINE) &&
 	    (pdev->device == PCI_DEVICE_ID_NFP3800_VF ||
@@ -1031,9 +1173,12 @@ static int nfp_pci_probe(struct pci_dev *pdev,
 		 nfp_hwinfo_lookup(pf->hwinfo, "assembly.revision"),
 		 nfp_hwinfo_lookup(pf->hwinfo, "cpld.version"));
 
+	nfp_probe_trace(pdev, "cpp init", &start);
+
 	err = nfp_pf_board_state_wait(pf);
 	if (err && nfp_pf_netdev)
 		goto err_hwinfo_free;
+	nfp_probe_trace(pdev, "board state wait", &start);
 
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(3, 8, 0)) && defined(CONFIG_PCI_IOV)
 	err = nfp_sriov_attr_add(&pdev->dev);
@@ -1043,6 +1188,7 @@ static int nfp_pci_probe(struct pci_dev *pdev,
 	err = nfp_nsp_init(pdev, pf);
 	if (err)
 		goto err_sriov_remove;
+	nfp_probe_trace(pdev, "nsp init", &start);
 
 	pf->mip = nfp_mip_open(pf->cpp);
 	pf->rtbl = __nfp_rtsym_table_read(pf->cpp, pf->mip);
@@ -1075,6 +1221,7 @@ static int nfp_pci_probe(struct pci_dev *pdev,
 	}
 
 	nfp_pf_cfg_hwinfo(pf);
+	nfp_probe_trace(pdev, "fw symbols", &start);
 
 	if (nfp_pf_netdev) {
 		err = nfp_net_pci_probe(pf);
@@ -1087,6 +1234,7 @@ static int nfp_pci_probe(struct pci_dev *pdev,
 	} else {
 		nfp_register_vnic(pf);
 	}
+	nfp_probe_trace(pdev, "vnic init", &start);
 
 	err = nfp_hwmon_register(pf);
 	if (err) {
@@ -1094,6 +1242,9 @@ static int nfp_pci_probe(struct pci_dev *pdev,
 		goto err_net_remove;
 	}
 
+	dev_info(&pdev->dev, "Probe completed in %lld ms\n",
+		 ktime_to_ms(ktime_sub(ktime_get(), probe_start)));
+
 	return 0;
 
 err_net_remove:
@@ -1164,7 +1315,7 @@ static void __nfp_pci_shutdown(struct pci_dev *pdev, bool unload_fw)
 	vfree(pf->dumpspec);
 	kfree(pf->rtbl);
 	nfp_mip_close(pf->mip);
-	if (unload_fw && pf->unload_fw_on_remove)
+	if (unload_fw && pf->unload_fw_on_remove && !nfp_fw_keep_loaded)
 		nfp_fw_unload(pf);
 
 	if (pf->nfp_dev_cpp)
@@ -1207,6 +1358,12 @@ static struct pci_driver nfp_pci_driver = {
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(3, 8, 0))
 	.sriov_configure	= nfp_pcie_sriov_configure,
 #endif
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4, 2, 0))
+	/* Firmware lookup and load take seconds per card, let multiple
+	 * cards probe (and load firmware) in parallel.
+	 */
+	.driver.probe_type	= PROBE_PREFER_ASYNCHRONOUS,
+#endif
 };
 
 #if !COMPAT__CAN_HAVE_MULTIPLE_MOD_TABLES
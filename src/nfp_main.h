@@ -29,6 +29,7 @@ struct platform_device;
 struct nfp_cpp;
 struct nfp_cpp_area;
 struct nfp_eth_table;
+struct nfp_eth_table_cache;
 struct nfp_hwinfo;
 struct nfp_mip;
 struct nfp_net;
@@ -83,6 +84,9 @@ struct nfp_dumpspec {
  * @dump_flag:		Store dump flag between set_dump and get_dump_flag
  * @dump_len:		Store dump length between set_dump and get_dump_flag
  * @eth_tbl:		NSP ETH table
+ * @eth_cache:		Shared NSP ETH table snapshot for port refreshes (RCU)
+ * @eth_cache_seq:	Bumped on port events to invalidate @eth_cache
+ * @eth_cache_lock:	Serializes NSP reads which replace @eth_cache
  * @nspi:		NSP identification info
  * @hwmon_dev:		pointer to hwmon device
  * @ddir:		Per-device debugfs directory
@@ -140,6 +144,9 @@ struct nfp_pf {
 	u32 dump_flag;
 	u32 dump_len;
 	struct nfp_eth_table *eth_tbl;
+	struct nfp_eth_table_cache __rcu *eth_cache;
+	atomic_t eth_cache_seq;
+	struct mutex eth_cache_lock;
 	struct nfp_nsp_identify *nspi;
 
 	struct device *hwmon_dev;
@@ -95,14 +95,25 @@
 #define NFP_NET_MAX_IRQS	(NFP_NET_NON_Q_VECTORS + NFP_NET_MAX_R_VECS)
 
 #define NFP_NET_TX_DESCS_DEFAULT 4096	/* Default # of Tx descs per ring */
+#define NFP_NET_TX_COPYBREAK_MAX 256	/* Max. size of copied Tx packets */
 #define NFP_NET_RX_DESCS_DEFAULT 4096	/* Default # of Rx descs per ring */
 
 #define NFP_NET_FL_BATCH	16	/* Add freelist in this Batch size */
+#define NFP_NET_GRO_HW_MAX_LEN	8192	/* Min. FL buffer data w/ GRO-HW */
 #define NFP_NET_XDP_MAX_COMPLETE 2048	/* XDP bufs to reclaim in NAPI poll */
 
 /* MC definitions */
 #define NFP_NET_CFG_MAC_MC_MAX	1024	/* The maximum number of MC address per port*/
 
+/* aRFS definitions */
+#define NFP_NET_ARFS_MAX_ENTRY	256	/* Max. # of flows steered by aRFS */
+#define NFP_NET_ARFS_HASH_BITS	7
+#define NFP_NET_ARFS_HASH_SIZE	BIT(NFP_NET_ARFS_HASH_BITS)
+
+/* Number of counters in the device stats block of the control BAR */
+#define NFP_NET_HW_STATS_CNT	((NFP_NET_CFG_STATS_APP3_BYTES -	\
+				  NFP_NET_CFG_STATS_BASE) / 8 + 1)
+
 /* Offload definitions */
 #define NFP_NET_N_VXLAN_PORTS	(NFP_NET_CFG_VXLAN_SZ / sizeof(__be16))
 
@@ -165,10 +176,21 @@ struct nfp_nfdk_tx_buf;
  * @ktxbufs:	Array of transmitted TX buffers, to free on transmit (NFDK)
  * @txds:	Virtual address of TX ring in host memory (NFD3)
  * @ktxds:	Virtual address of TX ring in host memory (NFDK)
+ * @cb_buf:	Bounce area for copied small packets (copy-break)
+ * @cb_dma:	DMA address of the bounce area
+ * @cb_len:	Largest packet which is copied, 0 if copy-break is disabled
+ * @cb_stride:	Size of one bounce area slot
+ * @held_skb:	Packet held back to be placed in the next block (NFDK only)
+ * @held_meta:	TX metadata of @held_skb
+ * @held_ipsec:	@held_skb is to be encrypted by the IPsec offload
+ * @lat_wr_p:	Write pointer after the descriptors sampled for residency
+ * @lat_ts:	Time the sampled descriptors were given to the device (ns),
+ *		0 if no sample is in flight
  *
  * @qcidx:      Queue Controller Peripheral (QCP) queue index for the TX queue
  * @dma:        DMA address of the TX ring
  * @size:       Size, in bytes, of the TX ring (needed to free)
+ * @cb_size:	Size, in bytes, of the bounce area
  * @is_xdp:	Is this a XDP TX ring?
  */
 struct nfp_net_tx_ring {
@@ -195,11 +217,24 @@ struct nfp_net_tx_ring {
 		struct nfp_nfdk_tx_desc *ktxds;
 	};
 
+	u8 *cb_buf;
+	dma_addr_t cb_dma;
+	u16 cb_len;
+	u16 cb_stride;
+
+	struct sk_buff *held_skb;
+	u64 held_meta;
+	bool held_ipsec;
+
+	u32 lat_wr_p;
+	u64 lat_ts;
+
 	/* Cold data follows */
 	int qcidx;
 
 	dma_addr_t dma;
 	size_t size;
+	size_t cb_size;
 	bool is_xdp;
 } ____cacheline_aligned;
 
@@ -263,6 +298,9 @@ struct nfp_net_rx_desc {
 };
 
 #define NFP_NET_META_FIELD_MASK GENMASK(NFP_NET_META_FIELD_SIZE - 1, 0)
+/* Hash type field following a leading %NFP_NET_META_HASH field */
+#define NFP_NET_META_HASH_TYPE_MASK					\
+	GENMASK(2 * NFP_NET_META_FIELD_SIZE - 1, NFP_NET_META_FIELD_SIZE)
 #define NFP_NET_VLAN_CTAG	0
 #define NFP_NET_VLAN_STAG	1
 
@@ -278,6 +316,10 @@ struct nfp_meta_parsed {
 		u8 tpid;
 		u16 tci;
 	} vlan;
+	struct {
+		u16 segs;
+		u16 mss;
+	} gro;
 
 #ifdef CONFIG_NFP_NET_IPSEC
 	u32 ipsec_saidx;
@@ -347,6 +389,27 @@ struct nfp_net_rx_ring {
 	size_t size;
 } ____cacheline_aligned;
 
+#define NFP_NET_HIST_BUCKETS	16
+
+/**
+ * struct nfp_net_ring_stats - Optional datapath instrumentation of a vector
+ * @poll_work:		Histogram of RX packets handled per NAPI poll
+ * @budget_exhausted:	Number of NAPI polls which used up the whole budget
+ * @tx_batch:		Histogram of packets reclaimed per TX completion run
+ * @tx_residency:	Histogram of sampled time between handing descriptors
+ *			to the device and seeing them completed, in usecs
+ *
+ * Histogram bucket n counts values in [2^(n - 1), 2^n), bucket 0 counts
+ * zeros and the last bucket everything above.  Only updated while the
+ * ring_stats debugfs switch is on.
+ */
+struct nfp_net_ring_stats {
+	u64 poll_work[NFP_NET_HIST_BUCKETS];
+	u64 budget_exhausted;
+	u64 tx_batch[NFP_NET_HIST_BUCKETS];
+	u64 tx_residency[NFP_NET_HIST_BUCKETS];
+};
+
 /**
  * struct nfp_net_r_vector - Per ring interrupt vector configuration
  * @nfp_net:        Backpointer to nfp_net structure
@@ -378,6 +441,15 @@ struct nfp_net_rx_ring {
  * @hw_csum_tx_inner:	 Counter of inner TX checksum offload requests
  * @tx_gather:	    Counter of packets with Gather DMA
  * @tx_lso:	    Counter of LSO packets sent
+ * @tx_copybreak:   Counter of packets copied into the bounce area
+ * @tx_frag_pull:   Counter of packets with frags pulled into the head to
+ *		    fit the NFDK descriptor limit
+ * @tx_linearize:   Counter of packets linearized to fit the NFDK
+ *		    descriptor limit
+ * @tx_block_close: Counter of NFDK TX blocks closed early with NOPs
+ * @tx_nop_slots:   Number of NFDK TX descriptor slots filled with NOPs
+ * @tx_block_fill:  Counter of packets sent ahead of a held packet to fill
+ *		    a NFDK TX block
  * @hw_tls_tx:	    Counter of TLS packets sent with crypto offloaded to HW
  * @tls_tx_fallback:	Counter of TLS packets sent which had to be encrypted
  *			by the fallback path because packets came out of order
@@ -386,10 +458,21 @@ struct nfp_net_rx_ring {
  * @tx_errors:	    How many TX errors were encountered
  * @tx_busy:        How often was TX busy (no space)?
  * @rx_replace_buf_alloc_fail:	Counter of RX buffer allocation failures
+ * @hw_gro_rx:	    Counter of RX frames coalesced by the firmware
+ * @hw_gro_rx_segs: Number of wire segments in @hw_gro_rx frames
+ * @hw_gro_rx_miss: Counter of coalesced frames left without GSO info, the
+ *		    TCP header could not be found
+ * @irqs:	    Number of interrupts taken by this vector, only written by
+ *		    the interrupt handler, not protected by @rx_sync
+ * @polls_done:	    Number of NAPI polls which completed under budget
+ * @irq_rearm:	    Number of completed polls which unmasked the interrupt,
+ *		    the rest kept polling (busy poll, deferred hard IRQs).
+ *		    Updated after NAPI is released, hence atomic.
  * @irq_vector:     Interrupt vector number (use for talking to the OS)
  * @handler:        Interrupt handler for this ring vector
  * @name:           Name of the interrupt vector
  * @affinity_mask:  SMP affinity mask for this vector
+ * @ring_stats:     Optional latency and NAPI budget instrumentation
  *
  * This structure ties RX and TX rings to interrupt vectors and a NAPI
  * context. This currently only supports one RX and TX ring per
@@ -429,6 +512,12 @@ struct nfp_net_r_vector {
 
 	u64 hw_csum_rx_error;
 	u64 rx_replace_buf_alloc_fail;
+	u64 hw_gro_rx;
+	u64 hw_gro_rx_segs;
+	u64 hw_gro_rx_miss;
+	unsigned long irqs;
+	u64 polls_done;
+	atomic64_t irq_rearm;
 
 	struct nfp_net_tx_ring *xdp_ring;
 	struct xsk_buff_pool *xsk_pool;
@@ -441,6 +530,12 @@ struct nfp_net_r_vector {
 	u64 hw_csum_tx_inner;
 	u64 tx_gather;
 	u64 tx_lso;
+	u64 tx_copybreak;
+	u64 tx_frag_pull;
+	u64 tx_linearize;
+	u64 tx_block_close;
+	u64 tx_nop_slots;
+	u64 tx_block_fill;
 	u64 hw_tls_tx;
 
 	u64 tls_tx_fallback;
@@ -454,6 +549,8 @@ struct nfp_net_r_vector {
 	irq_handler_t handler;
 	char name[IFNAMSIZ + 8];
 	cpumask_t affinity_mask;
+
+	struct nfp_net_ring_stats ring_stats;
 } ____cacheline_aligned;
 
 /* Firmware version as it is written in the 32bit value in the BAR */
@@ -489,6 +586,7 @@ struct nfp_stat_pair {
  * @is_vf:		Is the driver attached to a VF?
  * @chained_metadata_format:  Firemware will use new metadata format
  * @ktls_tx:		Is kTLS TX enabled?
+ * @rx_meta_fast:	Try the hash (and mark) only metadata parser first
  * @rx_dma_dir:		Mapping direction for RX buffers
  * @rx_dma_off:		Offset at which DMA packets (for XDP headroom)
  * @rx_offset:		Offset in the RX buffers where packet data starts
@@ -505,6 +603,7 @@ struct nfp_stat_pair {
  * @txrwb_dma:		TX pointer write back area DMA address
  * @txd_cnt:		Size of the TX ring in number of min size packets
  * @rxd_cnt:		Size of the RX ring in number of min size packets
+ * @tx_copybreak:	Max. size of TX packets copied into a premapped buffer
  * @num_r_vecs:		Number of used ring vectors
  * @num_tx_rings:	Currently configured number of TX rings
  * @num_stack_tx_rings:	Number of TX rings used by the stack (not XDP)
@@ -519,6 +618,7 @@ struct nfp_net_dp {
 	u8 is_vf:1;
 	u8 chained_metadata_format:1;
 	u8 ktls_tx:1;
+	u8 rx_meta_fast:1;
 
 	u8 rx_dma_dir;
 	u8 rx_offset;
@@ -545,6 +645,7 @@ struct nfp_net_dp {
 
 	unsigned int txd_cnt;
 	unsigned int rxd_cnt;
+	unsigned int tx_copybreak;
 
 	unsigned int num_r_vecs;
 
@@ -610,6 +711,10 @@ struct nfp_net_dp {
  * @tx_bar:             Pointer to mapped TX queues
  * @rx_bar:             Pointer to mapped FL/RX queues
  * @xa_ipsec:           IPsec xarray SA data
+ * @ipsec_cfg:		IPsec SA config messages waiting for the mailbox
+ * @ipsec_cfg.lock:	Protect message list
+ * @ipsec_cfg.list:	List of messages to send
+ * @ipsec_cfg.work:	Work sending queued messages in batches
  * @tlv_caps:		Parsed TLV capabilities
  * @ktls_tx_conn_cnt:	Number of offloaded kTLS TX connections
  * @ktls_rx_conn_cnt:	Number of offloaded kTLS RX connections
@@ -619,6 +724,20 @@ struct nfp_net_dp {
  * @ktls_rx_resync_req:	Counter of TLS RX resync requested
  * @ktls_rx_resync_ign:	Counter of TLS RX resync requests ignored
  * @ktls_rx_resync_sent:    Counter of TLS RX resync completed
+ * @ktls_add_cnt:	Counter of kTLS connections offloaded
+ * @ktls_add_time_ns:	Total time spent offloading kTLS connections
+ * @ktls_del_deferred:	Counter of kTLS connection deletes sent in batches
+ * @ktls_del:		kTLS connection deletes waiting to be sent
+ * @ktls_del.lock:	Protect @ktls_del.list
+ * @ktls_del.list:	List of firmware handles to delete
+ * @ktls_del.work:	Delayed work posting the queued deletes together
+ * @ipsec_sa_add:	Counter of IPsec SAs installed in the firmware
+ * @ipsec_sa_add_fail:	Counter of IPsec SAs the firmware failed to install
+ * @ipsec_sa_del:	Counter of IPsec SAs invalidated in the firmware
+ * @ipsec_cfg_batch:	Counter of mailbox batches used to send IPsec SAs
+ * @arfs_add:		Counter of aRFS rules installed in the firmware
+ * @arfs_add_fail:	Counter of aRFS rules the firmware failed to install
+ * @arfs_expire:	Counter of aRFS rules removed after the flow expired
  * @mbox_cmsg:		Common Control Message via vNIC mailbox state
  * @mbox_cmsg.queue:	CCM mbox queue of pending messages
  * @mbox_cmsg.wq:	CCM mbox wait queue of waiting processes
@@ -626,6 +745,8 @@ struct nfp_net_dp {
  * @mbox_cmsg.wait_work:    CCM mbox posted msg reconfig wait work
  * @mbox_cmsg.runq_work:    CCM mbox posted msg queue runner work
  * @mbox_cmsg.tag:	CCM mbox message tag allocator
+ * @mbox_cmsg.batches:	CCM mbox batches sent to the firmware
+ * @mbox_cmsg.batch_msgs:   CCM mbox messages sent, over @batches gives fill
  * @debugfs_dir:	Device directory in debugfs
  * @vnic_list:		Entry on device vNIC list
  * @pdev:		Backpointer to PCI device
@@ -634,12 +755,33 @@ struct nfp_net_dp {
  *			-EOPNOTSUPP to keep backwards compatibility (set by app)
  * @port:		Pointer to nfp_port structure if vNIC is a port
  * @mbox_amsg:		Asynchronously processed message via mailbox
- * @mbox_amsg.lock:	Protect message list
+ * @mbox_amsg.lock:	Protect message list and statistics
  * @mbox_amsg.list:	List of message to process
  * @mbox_amsg.work:	Work to process message asynchronously
+ * @mbox_amsg.wq:	Ordered high priority workqueue for @mbox_amsg.work
+ * @mbox_amsg.depth:	Number of messages queued but not yet processed
+ * @mbox_amsg.max_depth:	Highest value @mbox_amsg.depth reached
+ * @mbox_amsg.processed:	Number of messages processed
+ * @mbox_amsg.lat_sum_ns:	Sum of queue to completion latencies
+ * @mbox_amsg.lat_max_ns:	Highest queue to completion latency
+ * @mbox_amsg.mc_coalesced:	Multicast messages dropped because an opposite
+ *				request for the same address was queued
  * @fs:			Flow steering
  * @fs.count:		Flow count
  * @fs.list:		List of flows
+ * @arfs:		Accelerated RFS state
+ * @arfs.lock:		Protects @arfs.hash, @arfs.ids and @arfs.active
+ * @arfs.active:	New flows may be steered (CPU rmap is set up)
+ * @arfs.unsupported:	FW does not support the aRFS rules, don't restart
+ * @arfs.hash:		Hash table of steered flows
+ * @arfs.ids:		Bitmap of used aRFS filter ids
+ * @arfs.work:		Work installing pending flows and expiring old ones
+ * @hw_stats:		Cached copy of the device stats block of the BAR
+ * @hw_stats.lock:	Serializes refreshes of @hw_stats.vals (single writer)
+ * @hw_stats.syncp:	Seqlock for readers of @hw_stats.vals
+ * @hw_stats.valid:	Device is running, @hw_stats.vals may be used
+ * @hw_stats.updated:	Time (jiffies) of the last refresh of @hw_stats.vals
+ * @hw_stats.vals:	Counters, indexed by offset from %NFP_NET_CFG_STATS_BASE
  * @app_priv:		APP private data for this vNIC
  */
 struct nfp_net {
@@ -715,6 +857,12 @@ struct nfp_net {
 
 #ifdef CONFIG_NFP_NET_IPSEC
 	struct xarray xa_ipsec;
+
+	struct {
+		spinlock_t lock;
+		struct list_head list;
+		struct work_struct work;
+	} ipsec_cfg;
 #endif
 
 	struct nfp_net_tlv_caps tlv_caps;
@@ -728,6 +876,23 @@ struct nfp_net {
 	atomic_t ktls_rx_resync_req;
 	atomic_t ktls_rx_resync_ign;
 	atomic_t ktls_rx_resync_sent;
+	atomic_t ktls_add_cnt;
+	atomic64_t ktls_add_time_ns;
+	atomic_t ktls_del_deferred;
+
+	struct {
+		spinlock_t lock;
+		struct list_head list;
+		struct delayed_work work;
+	} ktls_del;
+
+	atomic_t ipsec_sa_add;
+	atomic_t ipsec_sa_add_fail;
+	atomic_t ipsec_sa_del;
+	atomic_t ipsec_cfg_batch;
+	atomic_t arfs_add;
+	atomic_t arfs_add_fail;
+	atomic_t arfs_expire;
 
 	struct {
 		struct sk_buff_head queue;
@@ -736,6 +901,8 @@ struct nfp_net {
 		struct work_struct wait_work;
 		struct work_struct runq_work;
 		u16 tag;
+		atomic64_t batches;
+		atomic64_t batch_msgs;
 	} mbox_cmsg;
 
 	struct dentry *debugfs_dir;
@@ -753,6 +920,13 @@ struct nfp_net {
 		spinlock_t lock;
 		struct list_head list;
 		struct work_struct work;
+		struct workqueue_struct *wq;
+		unsigned int depth;
+		unsigned int max_depth;
+		u64 processed;
+		u64 lat_sum_ns;
+		u64 lat_max_ns;
+		u64 mc_coalesced;
 	} mbox_amsg;
 
 	struct {
@@ -760,9 +934,34 @@ struct nfp_net {
 		struct list_head list;
 	} fs;
 
+	struct {
+		spinlock_t lock;
+		bool active;
+		bool unsupported;
+		struct hlist_head hash[NFP_NET_ARFS_HASH_SIZE];
+		DECLARE_BITMAP(ids, NFP_NET_ARFS_MAX_ENTRY);
+		struct delayed_work work;
+	} arfs;
+
+	struct {
+		spinlock_t lock;
+		struct u64_stats_sync syncp;
+		bool valid;
+		unsigned long updated;
+		u64 vals[NFP_NET_HW_STATS_CNT];
+	} hw_stats;
+
 	void *app_priv;
 };
 
+#define NFP_FS_MAX_ENTRY	1024
+/* The top of the FW table is reserved for aRFS, ethtool gets the rest */
+#ifdef COMPAT__HAVE_ARFS
+#define NFP_FS_USER_MAX_ENTRY	(NFP_FS_MAX_ENTRY - NFP_NET_ARFS_MAX_ENTRY)
+#else
+#define NFP_FS_USER_MAX_ENTRY	NFP_FS_MAX_ENTRY
+#endif
+
 struct nfp_fs_entry {
 	struct list_head node;
 	u32 flow_type;
@@ -792,6 +991,7 @@ struct nfp_mbox_amsg_entry {
 	struct list_head list;
 	int (*cfg)(struct nfp_net *nn, struct nfp_mbox_amsg_entry *entry);
 	u32 cmd;
+	ktime_t enqueued;
 	char msg[];
 };
 
@@ -1044,14 +1244,54 @@ struct nfp_net_dp *nfp_net_clone_dp(struct nfp_net *nn);
 int nfp_net_ring_reconfig(struct nfp_net *nn, struct nfp_net_dp *new,
 			  struct netlink_ext_ack *extack);
 
+int __nfp_net_fs_add_hw(struct nfp_net *nn, struct nfp_fs_entry *entry,
+			bool quiet);
 int nfp_net_fs_add_hw(struct nfp_net *nn, struct nfp_fs_entry *entry);
 int nfp_net_fs_del_hw(struct nfp_net *nn, struct nfp_fs_entry *entry);
 
+u64 nfp_net_hw_stat_read(struct nfp_net *nn, unsigned int off);
+
+#ifdef COMPAT__HAVE_ARFS
+void nfp_net_arfs_init(struct nfp_net *nn);
+void nfp_net_arfs_start(struct nfp_net *nn);
+void nfp_net_arfs_stop(struct nfp_net *nn);
+void nfp_net_arfs_pause(struct nfp_net *nn);
+void nfp_net_arfs_resume(struct nfp_net *nn);
+void nfp_net_arfs_flush(struct nfp_net *nn);
+int nfp_net_rx_flow_steer(struct net_device *netdev, const struct sk_buff *skb,
+			  u16 rxq_index, u32 flow_id);
+#else
+static inline void nfp_net_arfs_init(struct nfp_net *nn)
+{
+}
+
+static inline void nfp_net_arfs_start(struct nfp_net *nn)
+{
+}
+
+static inline void nfp_net_arfs_stop(struct nfp_net *nn)
+{
+}
+
+static inline void nfp_net_arfs_pause(struct nfp_net *nn)
+{
+}
+
+static inline void nfp_net_arfs_resume(struct nfp_net *nn)
+{
+}
+
+static inline void nfp_net_arfs_flush(struct nfp_net *nn)
+{
+}
+#endif
+
 #ifdef CONFIG_NFP_DEBUG
 void nfp_net_debugfs_create(void);
 void nfp_net_debugfs_destroy(void);
 struct dentry *nfp_net_debugfs_device_add(struct pci_dev *pdev);
 void nfp_net_debugfs_vnic_add(struct nfp_net *nn, struct dentry *ddir);
+void nfp_net_debugfs_nsp_add(struct nfp_cpp *cpp, struct dentry *ddir);
 void nfp_net_debugfs_dir_clean(struct dentry **dir);
 #else
 static inline void nfp_net_debugfs_create(void)
@@ -1072,6 +1312,11 @@ nfp_net_debugfs_vnic_add(struct nfp_net *nn, struct dentry *ddir)
 {
 }
 
+static inline void
+nfp_net_debugfs_nsp_add(struct nfp_cpp *cpp, struct dentry *ddir)
+{
+}
+
 static inline void nfp_net_debugfs_dir_clean(struct dentry **dir)
 {
 }
@@ -0,0 +1,460 @@
+// SPDX-License-Identifier: (GPL-2.0-only OR BSD-2-Clause)
+/* Copyright (C) 2021 Corigine, Inc */
+
+#include "nfp_net_compat.h"
+
+#include <linux/cpu_rmap.h>
+#include <linux/hash.h>
+#include <linux/netdevice.h>
+#include <linux/skbuff.h>
+#include <linux/slab.h>
+#include <net/flow_dissector.h>
+#include <net/ipv6.h>
+
+#include "nfp_net.h"
+
+/* aRFS rules use the reserved top of the FW table, after the ethtool rule
+ * locations, so that user configured rules keep precedence.
+ */
+#define NFP_NET_ARFS_LOC(id)		(NFP_FS_USER_MAX_ENTRY + (id))
+
+/* Check this many installed flows for expiry per work run */
+#define NFP_NET_ARFS_EXPIRE_QUOTA	64
+#define NFP_NET_ARFS_EXPIRE_IVAL	HZ
+
+enum nfp_net_arfs_state {
+	NFP_NET_ARFS_ADD,
+	NFP_NET_ARFS_INSTALLED,
+	NFP_NET_ARFS_DEL,
+};
+
+/**
+ * struct nfp_net_arfs_entry - accelerated RFS flow
+ * @node:	entry in the @arfs.hash bucket
+ * @fs:		flow steering rule, @fs.action is the requested RX queue
+ * @flow_id:	RPS flow table index reported by the stack
+ * @id:		filter id, also determines rule location in the FW table
+ * @hw_rxq:	RX queue of the rule currently installed in the FW
+ * @in_hw:	a rule for this flow is installed in the FW
+ * @state:	pending action, see enum nfp_net_arfs_state
+ */
+struct nfp_net_arfs_entry {
+	struct hlist_node node;
+	struct nfp_fs_entry fs;
+	u32 flow_id;
+	u16 id;
+	u16 hw_rxq;
+	bool in_hw;
+	u8 state;
+};
+
+static int
+nfp_net_arfs_fill(struct nfp_fs_entry *fs, const struct sk_buff *skb)
+{
+	struct flow_keys keys;
+
+	if (skb->encapsulation)
+		return -EPROTONOSUPPORT;
+
+	if (!skb_flow_dissect_flow_keys(skb, &keys, 0))
+		return -EPROTONOSUPPORT;
+
+	if (keys.control.flags & FLOW_DIS_IS_FRAGMENT)
+		return -EPROTONOSUPPORT;
+
+	switch (keys.basic.ip_proto) {
+	case IPPROTO_TCP:
+	case IPPROTO_UDP:
+		break;
+	default:
+		return -EPROTONOSUPPORT;
+	}
+
+	switch (keys.basic.n_proto) {
+	case htons(ETH_P_IP):
+		fs->flow_type = keys.basic.ip_proto == IPPROTO_TCP ?
+				TCP_V4_FLOW : UDP_V4_FLOW;
+		fs->key.sip4 = keys.addrs.v4addrs.src;
+		fs->key.dip4 = keys.addrs.v4addrs.dst;
+		fs->msk.sip4 = htonl(~0);
+		fs->msk.dip4 = htonl(~0);
+		break;
+	case htons(ETH_P_IPV6):
+		fs->flow_type = keys.basic.ip_proto == IPPROTO_TCP ?
+				TCP_V6_FLOW : UDP_V6_FLOW;
+		memcpy(fs->key.sip6, &keys.addrs.v6addrs.src,
+		       sizeof(fs->key.sip6));
+		memcpy(fs->key.dip6, &keys.addrs.v6addrs.dst,
+		       sizeof(fs->key.dip6));
+		memset(fs->msk.sip6, 0xff, sizeof(fs->msk.sip6));
+		memset(fs->msk.dip6, 0xff, sizeof(fs->msk.dip6));
+		break;
+	default:
+		return -EPROTONOSUPPORT;
+	}
+
+	fs->key.l4_proto = keys.basic.ip_proto;
+	fs->msk.l4_proto = 0xff;
+	fs->key.sport = keys.ports.src;
+	fs->key.dport = keys.ports.dst;
+	fs->msk.sport = htons(~0);
+	fs->msk.dport = htons(~0);
+
+	return 0;
+}
+
+static struct nfp_net_arfs_entry *
+nfp_net_arfs_lookup(struct hlist_head *head, const struct nfp_fs_entry *fs)
+{
+	struct nfp_net_arfs_entry *entry;
+
+	hlist_for_each_entry(entry, head, node)
+		if (entry->fs.flow_type == fs->flow_type &&
+		    !memcmp(&entry->fs.key, &fs->key, sizeof(fs->key)))
+			return entry;
+
+	return NULL;
+}
+
+int nfp_net_rx_flow_steer(struct net_device *netdev, const struct sk_buff *skb,
+			  u16 rxq_index, u32 flow_id)
+{
+	struct nfp_net *nn = netdev_priv(netdev);
+	struct nfp_net_arfs_entry *entry;
+	struct nfp_fs_entry fs = {};
+	struct hlist_head *head;
+	unsigned int id;
+	int err;
+
+	err = nfp_net_arfs_fill(&fs, skb);
+	if (err)
+		return err;
+
+	head = &nn->arfs.hash[hash_32(skb_get_hash_raw(skb),
+				      NFP_NET_ARFS_HASH_BITS)];
+
+	spin_lock_bh(&nn->arfs.lock);
+	if (!nn->arfs.active) {
+		err = -EOPNOTSUPP;
+		goto err_unlock;
+	}
+
+	entry = nfp_net_arfs_lookup(head, &fs);
+	if (entry) {
+		if (entry->fs.action != rxq_index &&
+		    entry->state != NFP_NET_ARFS_DEL) {
+			entry->fs.action = rxq_index;
+			entry->state = NFP_NET_ARFS_ADD;
+			mod_delayed_work(nn->mbox_amsg.wq, &nn->arfs.work, 0);
+		}
+		entry->flow_id = flow_id;
+		id = entry->id;
+		goto out_unlock;
+	}
+
+	id = find_first_zero_bit(nn->arfs.ids, NFP_NET_ARFS_MAX_ENTRY);
+	if (id >= NFP_NET_ARFS_MAX_ENTRY) {
+		err = -ENOSPC;
+		goto err_unlock;
+	}
+
+	entry = kmalloc(sizeof(*entry), GFP_ATOMIC);
+	if (!entry) {
+		err = -ENOMEM;
+		goto err_unlock;
+	}
+
+	__set_bit(id, nn->arfs.ids);
+	entry->fs = fs;
+	entry->fs.action = rxq_index;
+	entry->fs.loc = NFP_NET_ARFS_LOC(id);
+	entry->flow_id = flow_id;
+	entry->id = id;
+	entry->in_hw = false;
+	entry->state = NFP_NET_ARFS_ADD;
+	hlist_add_head(&entry->node, head);
+
+	mod_delayed_work(nn->mbox_amsg.wq, &nn->arfs.work, 0);
+out_unlock:
+	spin_unlock_bh(&nn->arfs.lock);
+
+	return id;
+
+err_unlock:
+	spin_unlock_bh(&nn->arfs.lock);
+	return err;
+}
+
+static void
+nfp_net_arfs_del_hw(struct nfp_net *nn, struct nfp_net_arfs_entry *entry)
+{
+	struct nfp_fs_entry fs = entry->fs;
+
+	if (!entry->in_hw)
+		return;
+
+	fs.action = entry->hw_rxq;
+	nfp_net_fs_del_hw(nn, &fs);
+	entry->in_hw = false;
+}
+
+static void nfp_net_arfs_release(struct nfp_net *nn, struct hlist_head *list)
+{
+	struct nfp_net_arfs_entry *entry;
+	struct hlist_node *tmp;
+
+	hlist_for_each_entry_safe(entry, tmp, list, node) {
+		nfp_net_arfs_del_hw(nn, entry);
+
+		/* Don't let the location be reused before the rule is gone */
+		spin_lock_bh(&nn->arfs.lock);
+		__clear_bit(entry->id, nn->arfs.ids);
+		spin_unlock_bh(&nn->arfs.lock);
+
+		hlist_del(&entry->node);
+		kfree(entry);
+	}
+}
+
+/* Install one pending flow of the bucket, return false if none was found */
+static bool nfp_net_arfs_install_one(struct nfp_net *nn, struct hlist_head *head)
+{
+	struct nfp_net_arfs_entry *entry, tmp;
+	bool rejected = false;
+	int err;
+
+	spin_lock_bh(&nn->arfs.lock);
+	hlist_for_each_entry(entry, head, node)
+		if (entry->state == NFP_NET_ARFS_ADD)
+			break;
+	if (!entry) {
+		spin_unlock_bh(&nn->arfs.lock);
+		return false;
+	}
+	/* aRFS got disabled, drop the flows still waiting to be installed */
+	if (!nn->arfs.active) {
+		entry->state = NFP_NET_ARFS_DEL;
+		spin_unlock_bh(&nn->arfs.lock);
+		return true;
+	}
+	/* Stack may redirect the flow again while we talk to the FW,
+	 * that will move the entry back to NFP_NET_ARFS_ADD.
+	 */
+	entry->state = NFP_NET_ARFS_INSTALLED;
+	tmp = *entry;
+	spin_unlock_bh(&nn->arfs.lock);
+
+	/* Only the work changes the HW state, entry can't go away under us */
+	nfp_net_arfs_del_hw(nn, &tmp);
+	/* Failures are counted in arfs_add_fail, don't log each flow */
+	err = __nfp_net_fs_add_hw(nn, &tmp.fs, true);
+
+	spin_lock_bh(&nn->arfs.lock);
+	entry->in_hw = !err;
+	entry->hw_rxq = tmp.fs.action;
+	if (err) {
+		atomic_inc(&nn->arfs_add_fail);
+		entry->state = NFP_NET_ARFS_DEL;
+		/* Only give up for good if the FW said it can't do it,
+		 * mailbox timeouts or a full table are transient.
+		 */
+		if (err == -EOPNOTSUPP && nn->arfs.active) {
+			nn->arfs.active = false;
+			nn->arfs.unsupported = true;
+			rejected = true;
+		}
+	} else {
+		atomic_inc(&nn->arfs_add);
+	}
+	spin_unlock_bh(&nn->arfs.lock);
+
+	if (rejected)
+		nn_warn(nn, "FW does not support aRFS rules, aRFS disabled\n");
+
+	return true;
+}
+
+static void nfp_net_arfs_work(struct work_struct *work)
+{
+	unsigned int quota = NFP_NET_ARFS_EXPIRE_QUOTA;
+	struct nfp_net_arfs_entry *entry;
+	struct hlist_node *tmp;
+	HLIST_HEAD(del_list);
+	struct nfp_net *nn;
+	bool pending;
+	int i;
+
+	nn = container_of(to_delayed_work(work), struct nfp_net, arfs.work);
+
+	for (i = 0; i < NFP_NET_ARFS_HASH_SIZE; i++)
+		while (nfp_net_arfs_install_one(nn, &nn->arfs.hash[i]))
+			;
+
+	spin_lock_bh(&nn->arfs.lock);
+	for (i = 0; i < NFP_NET_ARFS_HASH_SIZE; i++) {
+		hlist_for_each_entry_safe(entry, tmp, &nn->arfs.hash[i],
+					  node) {
+			if (entry->state == NFP_NET_ARFS_INSTALLED && quota &&
+			    rps_may_expire_flow(nn->dp.netdev, entry->fs.action,
+						entry->flow_id, entry->id)) {
+				quota--;
+				atomic_inc(&nn->arfs_expire);
+				entry->state = NFP_NET_ARFS_DEL;
+			}
+			if (entry->state != NFP_NET_ARFS_DEL)
+				continue;
+
+			hlist_del(&entry->node);
+			hlist_add_head(&entry->node, &del_list);
+		}
+	}
+	spin_unlock_bh(&nn->arfs.lock);
+
+	nfp_net_arfs_release(nn, &del_list);
+
+	spin_lock_bh(&nn->arfs.lock);
+	pending = !bitmap_empty(nn->arfs.ids, NFP_NET_ARFS_MAX_ENTRY);
+	if (pending && nn->arfs.active)
+		queue_delayed_work(nn->mbox_amsg.wq, &nn->arfs.work,
+				   NFP_NET_ARFS_EXPIRE_IVAL);
+	spin_unlock_bh(&nn->arfs.lock);
+}
+
+/**
+ * nfp_net_arfs_flush() - remove all aRFS rules
+ * @nn:		NFP Net device structure
+ *
+ * Must not race with nfp_net_arfs_stop(), called under RTNL.
+ */
+void nfp_net_arfs_flush(struct nfp_net *nn)
+{
+	struct nfp_net_arfs_entry *entry;
+	struct hlist_node *tmp;
+	HLIST_HEAD(del_list);
+	bool active;
+	int i;
+
+	spin_lock_bh(&nn->arfs.lock);
+	active = nn->arfs.active;
+	nn->arfs.active = false;
+	spin_unlock_bh(&nn->arfs.lock);
+
+	cancel_delayed_work_sync(&nn->arfs.work);
+
+	spin_lock_bh(&nn->arfs.lock);
+	for (i = 0; i < NFP_NET_ARFS_HASH_SIZE; i++)
+		hlist_for_each_entry_safe(entry, tmp, &nn->arfs.hash[i], node) {
+			hlist_del(&entry->node);
+			hlist_add_head(&entry->node, &del_list);
+		}
+	spin_unlock_bh(&nn->arfs.lock);
+
+	nfp_net_arfs_release(nn, &del_list);
+
+	spin_lock_bh(&nn->arfs.lock);
+	nn->arfs.active = active;
+	spin_unlock_bh(&nn->arfs.lock);
+}
+
+/**
+ * nfp_net_arfs_start() - enable aRFS on an open vNIC
+ * @nn:		NFP Net device structure
+ *
+ * Map RX queues to the CPUs their interrupts are affine to, so that the
+ * stack can request steering of flows to the consuming CPU's queue.
+ */
+void nfp_net_arfs_start(struct nfp_net *nn)
+{
+	struct net_device *netdev = nn->dp.netdev;
+	struct cpu_rmap *rmap;
+	unsigned int r;
+	int err;
+
+	if (!(netdev->hw_features & NETIF_F_NTUPLE) || nn->arfs.unsupported)
+		return;
+
+	rmap = alloc_irq_cpu_rmap(nn->dp.num_rx_rings);
+	if (!rmap) {
+		nn_warn(nn, "failed to allocate CPU rmap, aRFS disabled\n");
+		return;
+	}
+
+	for (r = 0; r < nn->dp.num_rx_rings; r++) {
+		err = irq_cpu_rmap_add(rmap, nn->r_vecs[r].irq_vector);
+		if (err) {
+			nn_warn(nn, "failed to set up CPU rmap: %d, aRFS disabled\n",
+				err);
+			free_irq_cpu_rmap(rmap);
+			return;
+		}
+	}
+	netdev->rx_cpu_rmap = rmap;
+
+	spin_lock_bh(&nn->arfs.lock);
+	nn->arfs.active = true;
+	spin_unlock_bh(&nn->arfs.lock);
+}
+
+/**
+ * nfp_net_arfs_stop() - disable aRFS and remove all its rules
+ * @nn:		NFP Net device structure
+ *
+ * Must be called before the vNIC's RX interrupts are freed.
+ */
+void nfp_net_arfs_stop(struct nfp_net *nn)
+{
+	struct net_device *netdev = nn->dp.netdev;
+
+	if (!netdev->rx_cpu_rmap)
+		return;
+
+	nfp_net_arfs_flush(nn);
+
+	spin_lock_bh(&nn->arfs.lock);
+	nn->arfs.active = false;
+	spin_unlock_bh(&nn->arfs.lock);
+
+	free_irq_cpu_rmap(netdev->rx_cpu_rmap);
+	netdev->rx_cpu_rmap = NULL;
+}
+
+/**
+ * nfp_net_arfs_pause() - stop steering new flows, keep installed rules
+ * @nn:		NFP Net device structure
+ *
+ * Used around datapath reconfigurations which keep the RX rings and their
+ * interrupts, so the installed rules and the CPU rmap remain valid.
+ */
+void nfp_net_arfs_pause(struct nfp_net *nn)
+{
+	if (!nn->dp.netdev->rx_cpu_rmap)
+		return;
+
+	spin_lock_bh(&nn->arfs.lock);
+	nn->arfs.active = false;
+	spin_unlock_bh(&nn->arfs.lock);
+
+	cancel_delayed_work_sync(&nn->arfs.work);
+}
+
+/**
+ * nfp_net_arfs_resume() - resume aRFS after nfp_net_arfs_pause()
+ * @nn:		NFP Net device structure
+ */
+void nfp_net_arfs_resume(struct nfp_net *nn)
+{
+	if (!nn->dp.netdev->rx_cpu_rmap)
+		return;
+
+	spin_lock_bh(&nn->arfs.lock);
+	nn->arfs.active = !nn->arfs.unsupported;
+	if (nn->arfs.active)
+		mod_delayed_work(nn->mbox_amsg.wq, &nn->arfs.work, 0);
+	spin_unlock_bh(&nn->arfs.lock);
+}
+
+void nfp_net_arfs_init(struct nfp_net *nn)
+{
+	spin_lock_init(&nn->arfs.lock);
+	INIT_DELAYED_WORK(&nn->arfs.work, nfp_net_arfs_work);
+}
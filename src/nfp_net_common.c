@@ -72,6 +72,25 @@
 static int nfp_net_mc_unsync(struct net_device *netdev, const unsigned char *addr);
 #endif
 
+static unsigned int hw_stats_interval_ms;
+module_param(hw_stats_interval_ms, uint, 0644);
+MODULE_PARM_DESC(hw_stats_interval_ms, "Serve device stats of running vNICs from a copy at most given number of ms old, 0 reads the BAR on every request (default = 0)");
+
+/**
+ * nfp_net_rx_meta_select() - Pick the RX metadata parser for the enabled caps
+ * @dp:      NFP Net data path struct
+ *
+ * The hash (and mark) only parser is tried first when RSS puts the hash in
+ * the chained metadata, unless another feature adds a field to every packet
+ * which would make it miss all the time.
+ */
+static void nfp_net_rx_meta_select(struct nfp_net_dp *dp)
+{
+	dp->rx_meta_fast = dp->chained_metadata_format &&
+			   dp->ctrl & NFP_NET_CFG_CTRL_RSS_ANY &&
+			   !(dp->ctrl & NFP_NET_CFG_CTRL_CSUM_COMPLETE);
+}
+
 /**
  * nfp_net_get_fw_version() - Read and parse the FW version
  * @fw_ver:	Output fw_version structure to read to
@@ -473,6 +492,7 @@ static irqreturn_t nfp_net_irq_rxtx(int irq, void *data)
 	 */
 	r_vec->event_ctr++;
 #endif
+	WRITE_ONCE(r_vec->irqs, r_vec->irqs + 1);
 
 	napi_schedule_irqoff(&r_vec->napi);
 
@@ -512,7 +532,7 @@ static void nfp_net_read_link_status(struct nfp_net *nn)
 
 	nn->link_up = link_up;
 	if (nn->port) {
-		set_bit(NFP_PORT_CHANGED, &nn->port->flags);
+		nfp_net_port_changed(nn->port);
 		if (nn->port->link_cb)
 			nn->port->link_cb(nn->port);
 	}
@@ -733,13 +753,17 @@ static void nfp_net_tx_timeout(struct net_device *netdev, unsigned int txqueue)
 static unsigned int
 nfp_net_calc_fl_bufsz_data(struct nfp_net_dp *dp)
 {
-	unsigned int fl_bufsz = 0;
+	unsigned int fl_bufsz = 0, mtu = dp->mtu;
+
+	/* FW coalesces frames up to the size of the freelist buffers */
+	if (dp->ctrl_w1 & NFP_NET_CFG_CTRL_GRO_HW)
+		mtu = max_t(unsigned int, mtu, NFP_NET_GRO_HW_MAX_LEN);
 
 	if (dp->rx_offset == NFP_NET_CFG_RX_OFFSET_DYNAMIC)
 		fl_bufsz += NFP_NET_MAX_PREPEND;
 	else
 		fl_bufsz += dp->rx_offset;
-	fl_bufsz += ETH_HLEN + VLAN_HLEN * 2 + dp->mtu;
+	fl_bufsz += ETH_HLEN + VLAN_HLEN * 2 + mtu;
 
 	return fl_bufsz;
 }
@@ -838,6 +862,11 @@ nfp_net_napi_add(struct nfp_net_dp *dp, struct nfp_net_r_vector *r_vec, int idx)
 #endif
 	else
 		tasklet_enable(&r_vec->tasklet);
+
+#ifdef COMPAT__HAVE_NAPI_QUEUE_LINK
+	if (dp->netdev)
+		netif_napi_set_irq(&r_vec->napi, r_vec->irq_vector);
+#endif
 }
 
 static void
@@ -849,6 +878,32 @@ nfp_net_napi_del(struct nfp_net_dp *dp, struct nfp_net_r_vector *r_vec)
 		tasklet_disable(&r_vec->tasklet);
 }
 
+/**
+ * nfp_net_vector_link_queues() - Report the NAPI instance serving the queues
+ * @nn:      NFP Net device structure
+ * @r_vec:   Ring vector
+ * @idx:     Ring vector index
+ * @link:    Link (on open) or unlink (on close) the queues
+ *
+ * Lets user space find the NAPI ID of a queue, to set up busy polling and
+ * per-NAPI IRQ deferral for it.
+ */
+static void
+nfp_net_vector_link_queues(struct nfp_net *nn, struct nfp_net_r_vector *r_vec,
+			   unsigned int idx, bool link)
+{
+#ifdef COMPAT__HAVE_NAPI_QUEUE_LINK
+	struct napi_struct *napi = link ? &r_vec->napi : NULL;
+
+	if (r_vec->rx_ring)
+		netif_queue_set_napi(nn->dp.netdev, idx, NETDEV_QUEUE_TYPE_RX,
+				     napi);
+	if (r_vec->tx_ring)
+		netif_queue_set_napi(nn->dp.netdev, idx, NETDEV_QUEUE_TYPE_TX,
+				     napi);
+#endif
+}
+
 static void
 nfp_net_vector_assign_rings(struct nfp_net_dp *dp,
 			    struct nfp_net_r_vector *r_vec, int idx)
@@ -1122,6 +1177,7 @@ static int nfp_net_set_config_and_enable(struct nfp_net *nn)
 
 	nn->dp.ctrl = new_ctrl;
 	nn->dp.ctrl_w1 = new_ctrl_w1;
+	nfp_net_rx_meta_select(&nn->dp);
 
 	for (r = 0; r < nn->dp.num_rx_rings; r++)
 		nfp_net_rx_ring_fill_freelist(&nn->dp, &nn->dp.rx_rings[r]);
@@ -1154,6 +1210,76 @@ static int nfp_net_set_config_and_enable(struct nfp_net *nn)
 	return 0;
 }
 
+static void nfp_net_hw_stats_refresh(struct nfp_net *nn)
+{
+	unsigned int i;
+
+	u64_stats_update_begin(&nn->hw_stats.syncp);
+	for (i = 0; i < NFP_NET_HW_STATS_CNT; i++)
+		nn->hw_stats.vals[i] =
+			nn_readq(nn, NFP_NET_CFG_STATS_BASE + i * 8);
+	u64_stats_update_end(&nn->hw_stats.syncp);
+}
+
+static bool nfp_net_hw_stats_stale(struct nfp_net *nn, unsigned int interval)
+{
+	unsigned long updated = READ_ONCE(nn->hw_stats.updated);
+
+	return !time_in_range(jiffies, updated,
+			      updated + msecs_to_jiffies(interval));
+}
+
+/**
+ * nfp_net_hw_stat_read() - Read a counter from the device stats block
+ * @nn:      NFP Net device structure
+ * @off:     Offset of the counter in the BAR (%NFP_NET_CFG_STATS_*)
+ *
+ * If the cache is enabled and the device is running the value will be at
+ * most hw_stats_interval_ms old, otherwise it is read from the BAR.  The
+ * copy is refreshed by whichever reader finds it stale, there is no timer.
+ *
+ * Return: value of the counter.
+ */
+u64 nfp_net_hw_stat_read(struct nfp_net *nn, unsigned int off)
+{
+	unsigned int idx = (off - NFP_NET_CFG_STATS_BASE) / 8;
+	unsigned int interval, start;
+	u64 val;
+
+	interval = READ_ONCE(hw_stats_interval_ms);
+	if (!interval || !READ_ONCE(nn->hw_stats.valid))
+		return nn_readq(nn, off);
+
+	if (nfp_net_hw_stats_stale(nn, interval)) {
+		/* BHs off so a reader can't interrupt the writer on its CPU */
+		spin_lock_bh(&nn->hw_stats.lock);
+		if (nfp_net_hw_stats_stale(nn, interval)) {
+			nfp_net_hw_stats_refresh(nn);
+			WRITE_ONCE(nn->hw_stats.updated, jiffies);
+		}
+		spin_unlock_bh(&nn->hw_stats.lock);
+	}
+
+	do {
+		start = u64_stats_fetch_begin(&nn->hw_stats.syncp);
+		val = nn->hw_stats.vals[idx];
+	} while (u64_stats_fetch_retry(&nn->hw_stats.syncp, start));
+
+	return val;
+}
+
+static void nfp_net_hw_stats_start(struct nfp_net *nn)
+{
+	/* Make sure the first read after open refreshes the copy */
+	WRITE_ONCE(nn->hw_stats.updated, jiffies - MAX_JIFFY_OFFSET);
+	WRITE_ONCE(nn->hw_stats.valid, true);
+}
+
+static void nfp_net_hw_stats_stop(struct nfp_net *nn)
+{
+	WRITE_ONCE(nn->hw_stats.valid, false);
+}
+
 /**
  * nfp_net_close_stack() - Quiesce the stack (part of close)
  * @nn:	     NFP Net device to reconfigure
@@ -1163,6 +1289,8 @@ static void nfp_net_close_stack(struct nfp_net *nn)
 	struct nfp_net_r_vector *r_vec;
 	unsigned int r;
 
+	nfp_net_hw_stats_stop(nn);
+
 	disable_irq(nn->irq_entries[NFP_NET_IRQ_LSC_IDX].vector);
 	netif_carrier_off(nn->dp.netdev);
 	nn->link_up = false;
@@ -1171,6 +1299,7 @@ static void nfp_net_close_stack(struct nfp_net *nn)
 		r_vec = &nn->r_vecs[r];
 
 		disable_irq(r_vec->irq_vector);
+		nfp_net_vector_link_queues(nn, r_vec, r, false);
 		napi_disable(&r_vec->napi);
 
 #ifdef COMPAT_HAVE_DIM
@@ -1213,6 +1342,7 @@ static int nfp_net_netdev_close(struct net_device *netdev)
 
 	/* Step 1: Disable RX and TX rings from the Linux kernel perspective
 	 */
+	nfp_net_arfs_stop(nn);
 	nfp_net_close_stack(nn);
 
 	/* Step 2: Tell NFP
@@ -1338,6 +1468,7 @@ static void nfp_net_open_stack(struct nfp_net *nn)
 #endif
 
 		napi_enable(&r_vec->napi);
+		nfp_net_vector_link_queues(nn, r_vec, r, true);
 		enable_irq(r_vec->irq_vector);
 	}
 
@@ -1345,6 +1476,8 @@ static void nfp_net_open_stack(struct nfp_net *nn)
 
 	enable_irq(nn->irq_entries[NFP_NET_IRQ_LSC_IDX].vector);
 	nfp_net_read_link_status(nn);
+
+	nfp_net_hw_stats_start(nn);
 }
 
 static int nfp_net_open_alloc_all(struct nfp_net *nn)
@@ -1440,6 +1573,7 @@ static int nfp_net_netdev_open(struct net_device *netdev)
 	 * - set link state
 	 */
 	nfp_net_open_stack(nn);
+	nfp_net_arfs_start(nn);
 
 	return 0;
 
@@ -1491,12 +1625,16 @@ int nfp_net_sched_mbox_amsg_work(struct nfp_net *nn, u32 cmd, const void *data,
 	memcpy(entry->msg, data, len);
 	entry->cmd = cmd;
 	entry->cfg = cb;
+	entry->enqueued = ktime_get();
 
 	spin_lock_bh(&nn->mbox_amsg.lock);
 	list_add_tail(&entry->list, &nn->mbox_amsg.list);
+	nn->mbox_amsg.depth++;
+	nn->mbox_amsg.max_depth = max(nn->mbox_amsg.max_depth,
+				      nn->mbox_amsg.depth);
 	spin_unlock_bh(&nn->mbox_amsg.lock);
 
-	schedule_work(&nn->mbox_amsg.work);
+	queue_work(nn->mbox_amsg.wq, &nn->mbox_amsg.work);
 
 	return 0;
 }
@@ -1506,7 +1644,9 @@ static void nfp_net_mbox_amsg_work(struct work_struct *work)
 #if LINUX_VERSION_CODE > KERNEL_VERSION(3, 15, 0)
 	struct nfp_net *nn = container_of(work, struct nfp_net, mbox_amsg.work);
 	struct nfp_mbox_amsg_entry *entry, *tmp;
+	u64 lat, lat_sum = 0, lat_max = 0;
 	struct list_head tmp_list;
+	unsigned int done = 0;
 
 	INIT_LIST_HEAD(&tmp_list);
 
@@ -1520,9 +1660,21 @@ static void nfp_net_mbox_amsg_work(struct work_struct *work)
 		if (err)
 			nn_err(nn, "Config cmd %d to HW failed %d.\n", entry->cmd, err);
 
+		lat = ktime_to_ns(ktime_sub(ktime_get(), entry->enqueued));
+		lat_max = max(lat_max, lat);
+		lat_sum += lat;
+		done++;
+
 		list_del(&entry->list);
 		kfree(entry);
 	}
+
+	spin_lock_bh(&nn->mbox_amsg.lock);
+	nn->mbox_amsg.depth -= done;
+	nn->mbox_amsg.processed += done;
+	nn->mbox_amsg.lat_sum_ns += lat_sum;
+	nn->mbox_amsg.lat_max_ns = max(nn->mbox_amsg.lat_max_ns, lat_max);
+	spin_unlock_bh(&nn->mbox_amsg.lock);
 #endif
 }
 
@@ -1544,6 +1696,34 @@ static int nfp_net_mc_cfg(struct nfp_net *nn, struct nfp_mbox_amsg_entry *entry)
 	return nfp_net_mbox_reconfig_and_unlock(nn, entry->cmd);
 }
 
+/* The firmware takes one multicast address per mailbox command. If the
+ * opposite command for the same address is still queued the two cancel
+ * out, drop the queued one instead of sending both.
+ */
+static bool
+nfp_net_mc_coalesce(struct nfp_net *nn, u32 cmd, const unsigned char *addr)
+{
+	struct nfp_mbox_amsg_entry *entry;
+	bool found = false;
+
+	spin_lock_bh(&nn->mbox_amsg.lock);
+	list_for_each_entry(entry, &nn->mbox_amsg.list, list) {
+		if (entry->cfg != nfp_net_mc_cfg || entry->cmd == cmd ||
+		    !ether_addr_equal_unaligned((u8 *)entry->msg, addr))
+			continue;
+
+		list_del(&entry->list);
+		nn->mbox_amsg.depth--;
+		nn->mbox_amsg.mc_coalesced += 2;
+		kfree(entry);
+		found = true;
+		break;
+	}
+	spin_unlock_bh(&nn->mbox_amsg.lock);
+
+	return found;
+}
+
 static int nfp_net_mc_sync(struct net_device *netdev, const unsigned char *addr)
 {
 	struct nfp_net *nn = netdev_priv(netdev);
@@ -1554,6 +1734,9 @@ static int nfp_net_mc_sync(struct net_device *netdev, const unsigned char *addr)
 		return -EINVAL;
 	}
 
+	if (nfp_net_mc_coalesce(nn, NFP_NET_CFG_MBOX_CMD_MULTICAST_ADD, addr))
+		return 0;
+
 	return nfp_net_sched_mbox_amsg_work(nn, NFP_NET_CFG_MBOX_CMD_MULTICAST_ADD, addr,
 					    NFP_NET_CFG_MULTICAST_SZ, nfp_net_mc_cfg);
 }
@@ -1562,6 +1745,9 @@ static int nfp_net_mc_unsync(struct net_device *netdev, const unsigned char *add
 {
 	struct nfp_net *nn = netdev_priv(netdev);
 
+	if (nfp_net_mc_coalesce(nn, NFP_NET_CFG_MBOX_CMD_MULTICAST_DEL, addr))
+		return 0;
+
 	return nfp_net_sched_mbox_amsg_work(nn, NFP_NET_CFG_MBOX_CMD_MULTICAST_DEL, addr,
 					    NFP_NET_CFG_MULTICAST_SZ, nfp_net_mc_cfg);
 }
@@ -1749,6 +1935,7 @@ nfp_net_check_config(struct nfp_net *nn, struct nfp_net_dp *dp,
 int nfp_net_ring_reconfig(struct nfp_net *nn, struct nfp_net_dp *dp,
 			  struct netlink_ext_ack *extack)
 {
+	bool arfs_restart;
 	int r, err;
 
 	dp->fl_bufsz = nfp_net_calc_fl_bufsz(dp);
@@ -1786,6 +1973,15 @@ int nfp_net_ring_reconfig(struct nfp_net *nn, struct nfp_net_dp *dp,
 	if (err)
 		goto err_free_rx;
 
+	/* aRFS rules and the CPU rmap only have to be rebuilt if the set of
+	 * RX rings changes, otherwise just hold off new rules.
+	 */
+	arfs_restart = dp->num_rx_rings != nn->dp.num_rx_rings;
+	if (arfs_restart)
+		nfp_net_arfs_stop(nn);
+	else
+		nfp_net_arfs_pause(nn);
+
 	/* Stop device, swap in new rings, try to start the firmware */
 	nfp_net_close_stack(nn);
 	nfp_net_clear_config_and_disable(nn);
@@ -1809,6 +2005,10 @@ int nfp_net_ring_reconfig(struct nfp_net *nn, struct nfp_net_dp *dp,
 	nfp_net_tx_rings_free(dp);
 
 	nfp_net_open_stack(nn);
+	if (arfs_restart)
+		nfp_net_arfs_start(nn);
+	else
+		nfp_net_arfs_resume(nn);
 exit_free_dp:
 	nfp_net_free_dp(dp);
 
@@ -1990,7 +2190,17 @@ nfp_net_fs_fill_act(struct nfp_net *nn, struct nfp_fs_entry *entry, u32 addr)
 	nn_writel(nn, addr, action);
 }
 
-int nfp_net_fs_add_hw(struct nfp_net *nn, struct nfp_fs_entry *entry)
+/**
+ * __nfp_net_fs_add_hw() - install a flow steering rule in the firmware
+ * @nn:		NFP Net device structure
+ * @entry:	Flow steering rule
+ * @quiet:	Don't log firmware rejections, caller accounts for them
+ *
+ * Return: 0 on success, negative errno otherwise.  Errors reported by the
+ * firmware are passed through, e.g. -EOPNOTSUPP.
+ */
+int __nfp_net_fs_add_hw(struct nfp_net *nn, struct nfp_fs_entry *entry,
+			bool quiet)
 {
 	u32 addr = nn->tlv_caps.mbox_off + NFP_NET_CFG_MBOX_SIMPLE_VAL;
 	int err;
@@ -2028,13 +2238,19 @@ int nfp_net_fs_add_hw(struct nfp_net *nn, struct nfp_fs_entry *entry)
 
 	err = nfp_net_mbox_reconfig_and_unlock(nn, NFP_NET_CFG_MBOX_CMD_FLOW_STEER);
 	if (err) {
-		nn_err(nn, "Add new fs rule failed with %d\n", err);
-		return -EIO;
+		if (!quiet)
+			nn_err(nn, "Add new fs rule failed with %d\n", err);
+		return err;
 	}
 
 	return 0;
 }
 
+int nfp_net_fs_add_hw(struct nfp_net *nn, struct nfp_fs_entry *entry)
+{
+	return __nfp_net_fs_add_hw(nn, entry, false) ? -EIO : 0;
+}
+
 int nfp_net_fs_del_hw(struct nfp_net *nn, struct nfp_fs_entry *entry)
 {
 	u32 addr = nn->tlv_caps.mbox_off + NFP_NET_CFG_MBOX_SIMPLE_VAL;
@@ -2140,18 +2356,44 @@ static compat__stat64_ret_t nfp_net_stat64(struct net_device *netdev,
 	}
 
 	/* Add in device stats */
-	stats->multicast += nn_readq(nn, NFP_NET_CFG_STATS_RX_MC_FRAMES);
-	stats->rx_dropped += nn_readq(nn, NFP_NET_CFG_STATS_RX_DISCARDS);
-	stats->rx_errors += nn_readq(nn, NFP_NET_CFG_STATS_RX_ERRORS);
+	stats->multicast +=
+		nfp_net_hw_stat_read(nn, NFP_NET_CFG_STATS_RX_MC_FRAMES);
+	stats->rx_dropped +=
+		nfp_net_hw_stat_read(nn, NFP_NET_CFG_STATS_RX_DISCARDS);
+	stats->rx_errors += nfp_net_hw_stat_read(nn, NFP_NET_CFG_STATS_RX_ERRORS);
 
-	stats->tx_dropped += nn_readq(nn, NFP_NET_CFG_STATS_TX_DISCARDS);
-	stats->tx_errors += nn_readq(nn, NFP_NET_CFG_STATS_TX_ERRORS);
+	stats->tx_dropped +=
+		nfp_net_hw_stat_read(nn, NFP_NET_CFG_STATS_TX_DISCARDS);
+	stats->tx_errors += nfp_net_hw_stat_read(nn, NFP_NET_CFG_STATS_TX_ERRORS);
 
 #if VER_NON_RHEL_LT(4, 11) || VER_RHEL_LT(7, 5)
 	return stats;
 #endif
 }
 
+#ifdef NETIF_F_GRO_HW
+static int nfp_net_set_gro_hw(struct nfp_net *nn, bool enable)
+{
+	struct nfp_net_dp *dp;
+
+	/* Already done by XDP setup */
+	if (enable == !!(nn->dp.ctrl_w1 & NFP_NET_CFG_CTRL_GRO_HW))
+		return 0;
+
+	dp = nfp_net_clone_dp(nn);
+	if (!dp)
+		return -ENOMEM;
+
+	if (enable)
+		dp->ctrl_w1 |= NFP_NET_CFG_CTRL_GRO_HW;
+	else
+		dp->ctrl_w1 &= ~NFP_NET_CFG_CTRL_GRO_HW;
+
+	/* Coalesced frames need bigger freelist buffers */
+	return nfp_net_ring_reconfig(nn, dp, NULL);
+}
+#endif
+
 static int nfp_net_set_features(struct net_device *netdev,
 				netdev_features_t features)
 {
@@ -2225,6 +2467,9 @@ static int nfp_net_set_features(struct net_device *netdev,
 			new_ctrl &= ~NFP_NET_CFG_CTRL_GATHER;
 	}
 
+	if ((changed & NETIF_F_NTUPLE) && !(features & NETIF_F_NTUPLE))
+		nfp_net_arfs_flush(nn);
+
 	err = nfp_port_set_features(netdev, features);
 	if (err)
 		return err;
@@ -2232,6 +2477,14 @@ static int nfp_net_set_features(struct net_device *netdev,
 	nn_dbg(nn, "Feature change 0x%llx -> 0x%llx (changed=0x%llx)\n",
 	       netdev->features, features, changed);
 
+#ifdef NETIF_F_GRO_HW
+	if (changed & NETIF_F_GRO_HW) {
+		err = nfp_net_set_gro_hw(nn, features & NETIF_F_GRO_HW);
+		if (err)
+			return err;
+	}
+#endif
+
 	if (new_ctrl == nn->dp.ctrl)
 		return 0;
 
@@ -2242,6 +2495,7 @@ static int nfp_net_set_features(struct net_device *netdev,
 		return err;
 
 	nn->dp.ctrl = new_ctrl;
+	nfp_net_rx_meta_select(&nn->dp);
 
 	return 0;
 }
@@ -2265,6 +2519,12 @@ nfp_net_fix_features(struct net_device *netdev,
 				    "S-tag and C-tag stripping can't be enabled at the same time. Enabling C-tag stripping and disabling S-tag stripping\n");
 		}
 	}
+
+#ifdef NETIF_F_GRO_HW
+	/* XDP programs can't deal with coalesced frames */
+	if (((struct nfp_net *)netdev_priv(netdev))->dp.xdp_prog)
+		features &= ~NETIF_F_GRO_HW;
+#endif
 	return features;
 }
 #endif
@@ -2489,12 +2749,20 @@ static int nfp_net_xdp_setup_drv(struct nfp_net *nn, struct netdev_bpf *bpf)
 	dp->num_tx_rings += prog ? nn->dp.num_rx_rings : -nn->dp.num_rx_rings;
 	dp->rx_dma_dir = prog ? DMA_BIDIRECTIONAL : DMA_FROM_DEVICE;
 	dp->rx_dma_off = prog ? XDP_PACKET_HEADROOM - nn->dp.rx_offset : 0;
+#ifdef NETIF_F_GRO_HW
+	/* XDP can't take coalesced frames, features are synced up below */
+	if (prog)
+		dp->ctrl_w1 &= ~NFP_NET_CFG_CTRL_GRO_HW;
+#endif
 
 	/* We need RX reconfig to remap the buffers (BIDIR vs FROM_DEV) */
 	err = nfp_net_ring_reconfig(nn, dp, compat__xdp_extact(bpf));
 	if (err)
 		return err;
 
+#ifdef NETIF_F_GRO_HW
+	netdev_update_features(nn->dp.netdev);
+#endif
 	xdp_attachment_setup(&nn->xdp, bpf);
 	return 0;
 }
@@ -2684,6 +2952,9 @@ const struct net_device_ops nfp_nfd3_netdev_ops = {
 #endif
 	.ndo_tx_timeout		= nfp_net_tx_timeout,
 	.ndo_set_rx_mode	= nfp_net_set_rx_mode,
+#ifdef COMPAT__HAVE_ARFS
+	.ndo_rx_flow_steer	= nfp_net_rx_flow_steer,
+#endif
 #if VER_IS_NON_RHEL || VER_RHEL_LT(7, 5) || VER_RHEL_GE(8, 0)
 	.ndo_change_mtu		= nfp_net_change_mtu,
 #elif VER_RHEL_GE(7, 5)
@@ -2780,6 +3051,9 @@ const struct net_device_ops nfp_nfdk_netdev_ops = {
 #endif
 	.ndo_tx_timeout		= nfp_net_tx_timeout,
 	.ndo_set_rx_mode	= nfp_net_set_rx_mode,
+#ifdef COMPAT__HAVE_ARFS
+	.ndo_rx_flow_steer	= nfp_net_rx_flow_steer,
+#endif
 #if VER_IS_NON_RHEL || VER_RHEL_LT(7, 5) || VER_RHEL_GE(8, 0)
 	.ndo_change_mtu		= nfp_net_change_mtu,
 #elif VER_RHEL_GE(7, 5)
@@ -2892,7 +3166,7 @@ void nfp_net_info(struct nfp_net *nn)
 		nn->fw_ver.extend, nn->fw_ver.class,
 		nn->fw_ver.major, nn->fw_ver.minor,
 		nn->max_mtu);
-	nn_info(nn, "CAP: %#x %s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s\n",
+	nn_info(nn, "CAP: %#x %s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s%s\n",
 		nn->cap,
 		nn->cap & NFP_NET_CFG_CTRL_PROMISC  ? "PROMISC "  : "",
 		nn->cap & NFP_NET_CFG_CTRL_L2BC     ? "L2BCFILT " : "",
@@ -2922,6 +3196,7 @@ void nfp_net_info(struct nfp_net *nn)
 		nn->cap & NFP_NET_CFG_CTRL_LIVE_ADDR ? "LIVE_ADDR " : "",
 		nn->cap_w1 & NFP_NET_CFG_CTRL_MCAST_FILTER ? "MULTICAST_FILTER " : "",
 		nn->cap_w1 & NFP_NET_CFG_CTRL_USO ? "USO " : "",
+		nn->cap_w1 & NFP_NET_CFG_CTRL_GRO_HW ? "GRO_HW " : "",
 		nfp_app_extra_cap(nn->app, nn));
 }
 
@@ -3189,6 +3464,11 @@ static void nfp_net_netdev_init(struct nfp_net *nn)
 	}
 	if (nn->cap & NFP_NET_CFG_CTRL_RSS_ANY)
 		netdev->hw_features |= NETIF_F_RXHASH;
+#ifdef NETIF_F_GRO_HW
+	/* HW GRO is off by default, like LRO it changes what the stack sees */
+	if (nn->cap_w1 & NFP_NET_CFG_CTRL_GRO_HW)
+		netdev->hw_features |= NETIF_F_GRO_HW;
+#endif
 
 #ifdef CONFIG_NFP_NET_IPSEC
        if (nn->cap_w1 & NFP_NET_CFG_CTRL_IPSEC)
@@ -3252,6 +3532,12 @@ static void nfp_net_netdev_init(struct nfp_net *nn)
 	if (nfp_app_has_tc(nn->app) && nn->port)
 		netdev->hw_features |= NETIF_F_HW_TC;
 
+#ifdef COMPAT__HAVE_ARFS
+	/* aRFS is off by default, steering rules are a limited resource */
+	if (nn->cap_w1 & NFP_NET_CFG_CTRL_FLOW_STEER)
+		netdev->hw_features |= NETIF_F_NTUPLE;
+#endif
+
 	/* C-Tag strip and S-Tag strip can't be supported simultaneously,
 	 * so enable C-Tag strip and disable S-Tag strip by default.
 	 */
@@ -3335,6 +3621,9 @@ static int nfp_net_read_caps(struct nfp_net *nn)
 
 	/* Mask out NFD-version-specific features */
 	nn->cap &= nn->dp.ops->cap_mask;
+	/* Coalesced frame metadata is only parsed by the NFDK datapath */
+	if (nn->dp.ops->version != NFP_NFD_VER_NFDK)
+		nn->cap_w1 &= ~NFP_NET_CFG_CTRL_GRO_HW;
 
 	/* For control vNICs mask out the capabilities app doesn't want. */
 	if (!nn->dp.netdev)
@@ -3429,14 +3718,36 @@ int nfp_net_init(struct nfp_net *nn)
 	if (!nn->dp.netdev)
 		return 0;
 
+	/* Ordered so that messages reach the firmware in the order they were
+	 * queued, high priority to keep SA installs and multicast joins
+	 * clear of system workqueue load.
+	 */
+	nn->mbox_amsg.wq = alloc_ordered_workqueue("nfp-amsg-%s-%u",
+						   WQ_HIGHPRI,
+						   pci_name(nn->pdev), nn->id);
+	if (!nn->mbox_amsg.wq) {
+		err = -ENOMEM;
+		goto err_clean_mbox;
+	}
+
 	spin_lock_init(&nn->mbox_amsg.lock);
 	INIT_LIST_HEAD(&nn->mbox_amsg.list);
 	INIT_WORK(&nn->mbox_amsg.work, nfp_net_mbox_amsg_work);
 
 	INIT_LIST_HEAD(&nn->fs.list);
+	nfp_net_arfs_init(nn);
+
+	spin_lock_init(&nn->hw_stats.lock);
+	u64_stats_init(&nn->hw_stats.syncp);
 
-	return register_netdev(nn->dp.netdev);
+	err = register_netdev(nn->dp.netdev);
+	if (err)
+		goto err_destroy_amsg_wq;
+
+	return 0;
 
+err_destroy_amsg_wq:
+	destroy_workqueue(nn->mbox_amsg.wq);
 err_clean_mbox:
 	nfp_ccm_mbox_clean(nn);
 	return err;
@@ -3453,8 +3764,9 @@ void nfp_net_clean(struct nfp_net *nn)
 
 	unregister_netdev(nn->dp.netdev);
 	nfp_net_ipsec_clean(nn);
+	nfp_net_tls_clean(nn);
 	nfp_ccm_mbox_clean(nn);
 	nfp_net_fs_clean(nn);
-	flush_work(&nn->mbox_amsg.work);
+	destroy_workqueue(nn->mbox_amsg.wq);
 	nfp_net_reconfig_wait_posted(nn);
 }
@@ -38,6 +38,11 @@ int nfp_net_refresh_eth_port(struct nfp_port *port)
 void nfp_net_refresh_port_table(struct nfp_port *port)
 {
 }
+
+void nfp_net_port_changed(struct nfp_port *port)
+{
+	set_bit(NFP_PORT_CHANGED, &port->flags);
+}
 #endif
 
 #ifndef COMPAT__HAVE_METADATA_IP_TUNNEL
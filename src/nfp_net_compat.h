@@ -349,6 +349,11 @@ static inline void compat_skb_set_hash(struct sk_buff *skb, __u32 hash,
 }
 
 #define skb_set_hash(s, h, t)	compat_skb_set_hash(s, h, t)
+
+static inline __u32 skb_get_hash_raw(const struct sk_buff *skb)
+{
+	return skb->rxhash;
+}
 #endif
 
 #if VER_NON_RHEL_LT(3, 14) || VER_RHEL_LT(7, 2)
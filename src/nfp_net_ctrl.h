@@ -39,6 +39,10 @@
 #define NFP_NET_META_VLAN_TPID_MASK		GENMASK(19, 16)
 #define NFP_NET_META_VLAN_TCI_MASK		GENMASK(15, 0)
 
+/* coalesced RX frame info (%NFP_NET_CFG_CTRL_GRO_HW) */
+#define NFP_NET_META_GRO_SEGS_MASK		GENMASK(31, 16)
+#define NFP_NET_META_GRO_MSS_MASK		GENMASK(15, 0)
+
 /* Prepend field types */
 #define NFP_NET_META_FIELD_SIZE		4
 #define NFP_NET_META_HASH		1 /* next field carries hash type */
@@ -49,6 +53,7 @@
 #define NFP_NET_META_CONN_HANDLE	7
 #define NFP_NET_META_RESYNC_INFO	8 /* RX resync info request */
 #define NFP_NET_META_IPSEC		9 /* IPsec SA index for tx and rx */
+#define NFP_NET_META_GRO_HW		10 /* RX coalesced segment count, MSS */
 
 #define NFP_META_PORT_ID_CTRL		~0U
 
@@ -271,6 +276,7 @@
 #define   NFP_NET_CFG_CTRL_FREELIST_EN	  (0x1 << 6) /* Freelist enable flag bit */
 #define   NFP_NET_CFG_CTRL_FLOW_STEER	  (0x1 << 8) /* Flow steering */
 #define   NFP_NET_CFG_CTRL_USO		  (0x1 << 16) /* UDP segmentation offload */
+#define   NFP_NET_CFG_CTRL_GRO_HW	  (0x1 << 17) /* TCP RX coalescing */
 
 #define NFP_NET_CFG_CAP_WORD1		0x00a4
 
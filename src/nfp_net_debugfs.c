@@ -7,6 +7,7 @@
 #include <linux/module.h>
 #include <linux/rtnetlink.h>
 
+#include "nfpcore/nfp_nsp.h"
 #include "nfp_net.h"
 #include "nfp_net_dp.h"
 
@@ -126,6 +127,116 @@ static int nfp_xdp_q_show(struct seq_file *file, void *data)
 DEFINE_SHOW_ATTRIBUTE(nfp_xdp_q);
 #endif
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 3, 0)
+static void
+nfp_ring_stats_hist_show(struct seq_file *file, const char *name,
+			 const u64 *hist)
+{
+	u64 lo, hi;
+	int i;
+
+	seq_printf(file, "%s:\n", name);
+	for (i = 0; i < NFP_NET_HIST_BUCKETS; i++) {
+		if (!hist[i])
+			continue;
+
+		lo = i ? 1ULL << (i - 1) : 0;
+		hi = i ? (1ULL << i) - 1 : 0;
+		if (i == NFP_NET_HIST_BUCKETS - 1)
+			seq_printf(file, "  %llu+: %llu\n", lo, hist[i]);
+		else
+			seq_printf(file, "  %llu-%llu: %llu\n", lo, hi, hist[i]);
+	}
+}
+
+static int nfp_ring_stats_show(struct seq_file *file, void *data)
+{
+	struct nfp_net_r_vector *r_vec = file->private;
+	struct nfp_net_ring_stats *stats = &r_vec->ring_stats;
+
+	seq_printf(file, "enabled: %d\n",
+		   static_key_enabled(&nfp_net_ring_stats_key));
+	seq_printf(file, "budget_exhausted: %llu\n", stats->budget_exhausted);
+	nfp_ring_stats_hist_show(file, "poll_work_pkts", stats->poll_work);
+	nfp_ring_stats_hist_show(file, "tx_batch_pkts", stats->tx_batch);
+	nfp_ring_stats_hist_show(file, "tx_residency_us", stats->tx_residency);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(nfp_ring_stats);
+
+static ssize_t
+nfp_ring_stats_enable_write(struct file *file, const char __user *buf,
+			    size_t count, loff_t *ppos)
+{
+	unsigned int enable;
+	int err;
+
+	err = kstrtouint_from_user(buf, count, 0, &enable);
+	if (err)
+		return err;
+
+	if (enable) {
+		/* Drop residency samples taken before the stats were off */
+		if (!static_key_enabled(&nfp_net_ring_stats_key))
+			WRITE_ONCE(nfp_net_ring_stats_epoch, ktime_get_ns());
+		static_branch_enable(&nfp_net_ring_stats_key);
+	} else {
+		static_branch_disable(&nfp_net_ring_stats_key);
+	}
+
+	return count;
+}
+
+static ssize_t
+nfp_ring_stats_enable_read(struct file *file, char __user *buf, size_t count,
+			   loff_t *ppos)
+{
+	char val[2] = { '0', '\n' };
+
+	if (static_key_enabled(&nfp_net_ring_stats_key))
+		val[0] = '1';
+
+	return simple_read_from_buffer(buf, count, ppos, val, sizeof(val));
+}
+
+static const struct file_operations nfp_ring_stats_enable_fops = {
+	.owner	= THIS_MODULE,
+	.open	= simple_open,
+	.read	= nfp_ring_stats_enable_read,
+	.write	= nfp_ring_stats_enable_write,
+	.llseek	= default_llseek,
+};
+#endif
+
+static int nfp_mbox_amsg_show(struct seq_file *file, void *data)
+{
+	struct nfp_net *nn = file->private;
+	u64 processed, lat_sum, lat_max;
+	unsigned int depth, max_depth;
+	u64 coalesced;
+
+	spin_lock_bh(&nn->mbox_amsg.lock);
+	depth = nn->mbox_amsg.depth;
+	max_depth = nn->mbox_amsg.max_depth;
+	processed = nn->mbox_amsg.processed;
+	lat_sum = nn->mbox_amsg.lat_sum_ns;
+	lat_max = nn->mbox_amsg.lat_max_ns;
+	coalesced = nn->mbox_amsg.mc_coalesced;
+	spin_unlock_bh(&nn->mbox_amsg.lock);
+
+	seq_printf(file, "depth:        %u\n", depth);
+	seq_printf(file, "max_depth:    %u\n", max_depth);
+	seq_printf(file, "processed:    %llu\n", processed);
+	seq_printf(file, "lat_avg_ns:   %llu\n",
+		   processed ? div64_u64(lat_sum, processed) : 0);
+	seq_printf(file, "lat_max_ns:   %llu\n", lat_max);
+	seq_printf(file, "mc_coalesced: %llu\n", coalesced);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(nfp_mbox_amsg);
+
 void nfp_net_debugfs_vnic_add(struct nfp_net *nn, struct dentry *ddir)
 {
 	struct dentry *queues, *tx, *rx, *xdp;
@@ -143,6 +254,10 @@ void nfp_net_debugfs_vnic_add(struct nfp_net *nn, struct dentry *ddir)
 	if (IS_ERR_OR_NULL(nn->debugfs_dir))
 		return;
 
+	if (nn->dp.netdev)
+		debugfs_create_file("mbox_amsg", 0400, nn->debugfs_dir, nn,
+				    &nfp_mbox_amsg_fops);
+
 	/* Create queue debugging sub-tree */
 	queues = debugfs_create_dir("queue", nn->debugfs_dir);
 	if (IS_ERR_OR_NULL(queues))
@@ -169,6 +284,21 @@ void nfp_net_debugfs_vnic_add(struct nfp_net *nn, struct dentry *ddir)
 		debugfs_create_file(name, 0400, tx,
 				    &nn->r_vecs[i], &nfp_tx_q_fops);
 	}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 3, 0)
+	if (nn->dp.netdev) {
+		struct dentry *stats = debugfs_create_dir("stats", queues);
+
+		if (IS_ERR_OR_NULL(stats))
+			return;
+
+		for (i = 0; i < nn->max_r_vecs; i++) {
+			sprintf(name, "%d", i);
+			debugfs_create_file(name, 0400, stats, &nn->r_vecs[i],
+					    &nfp_ring_stats_fops);
+		}
+	}
+#endif
 }
 
 struct dentry *nfp_net_debugfs_device_add(struct pci_dev *pdev)
@@ -185,6 +315,21 @@ struct dentry *nfp_net_debugfs_device_add(struct pci_dev *pdev)
 	return dev_dir;
 }
 
+static int nfp_net_nsp_stats_show(struct seq_file *file, void *data)
+{
+	nfp_nsp_stats_show(file->private, file);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(nfp_net_nsp_stats);
+
+void nfp_net_debugfs_nsp_add(struct nfp_cpp *cpp, struct dentry *ddir)
+{
+	if (IS_ERR_OR_NULL(ddir))
+		return;
+
+	debugfs_create_file("nsp_stats", 0400, ddir, cpp, &nfp_net_nsp_stats_fops);
+}
+
 void nfp_net_debugfs_dir_clean(struct dentry **dir)
 {
 	debugfs_remove_recursive(*dir);
@@ -194,6 +339,11 @@ void nfp_net_debugfs_dir_clean(struct dentry **dir)
 void nfp_net_debugfs_create(void)
 {
 	nfp_dir = debugfs_create_dir("nfp_net", NULL);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 3, 0)
+	if (!IS_ERR_OR_NULL(nfp_dir))
+		debugfs_create_file("ring_stats", 0600, nfp_dir, NULL,
+				    &nfp_ring_stats_enable_fops);
+#endif
 }
 
 void nfp_net_debugfs_destroy(void)
@@ -5,6 +5,11 @@
 #include "nfp_net_dp.h"
 #include "nfp_net_xsk.h"
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 3, 0)
+DEFINE_STATIC_KEY_FALSE(nfp_net_ring_stats_key);
+u64 nfp_net_ring_stats_epoch;
+#endif
+
 /**
  * nfp_net_rx_alloc_one() - Allocate and map page frag for RX
  * @dp:		NFP Net data path struct
@@ -180,6 +185,50 @@ nfp_net_rx_ring_bufs_alloc(struct nfp_net_dp *dp,
 	return 0;
 }
 
+/**
+ * nfp_net_tx_ring_cb_alloc() - Allocate the copy-break area of a TX ring
+ * @dp:		NFP Net data path struct
+ * @tx_ring:	TX ring structure
+ *
+ * The area has a slot for each packet the ring can hold and stays mapped
+ * for the lifetime of the ring.  XDP rings never copy packets.
+ *
+ * Return: 0 on success, negative errno otherwise.
+ */
+static int
+nfp_net_tx_ring_cb_alloc(struct nfp_net_dp *dp, struct nfp_net_tx_ring *tx_ring)
+{
+	if (!dp->tx_copybreak || tx_ring->is_xdp)
+		return 0;
+
+	tx_ring->cb_stride = ALIGN(dp->tx_copybreak, SMP_CACHE_BYTES);
+	tx_ring->cb_size = array_size(dp->txd_cnt, tx_ring->cb_stride);
+	tx_ring->cb_buf = dma_alloc_coherent(dp->dev, tx_ring->cb_size,
+					     &tx_ring->cb_dma,
+					     GFP_KERNEL | __GFP_NOWARN);
+	if (!tx_ring->cb_buf) {
+		netdev_warn(dp->netdev, "failed to allocate TX copy-break area, consider lowering tx-copybreak\n");
+		tx_ring->cb_size = 0;
+		return -ENOMEM;
+	}
+	tx_ring->cb_len = dp->tx_copybreak;
+
+	return 0;
+}
+
+static void
+nfp_net_tx_ring_cb_free(struct nfp_net_dp *dp, struct nfp_net_tx_ring *tx_ring)
+{
+	if (tx_ring->cb_buf)
+		dma_free_coherent(dp->dev, tx_ring->cb_size,
+				  tx_ring->cb_buf, tx_ring->cb_dma);
+
+	tx_ring->cb_buf = NULL;
+	tx_ring->cb_dma = 0;
+	tx_ring->cb_len = 0;
+	tx_ring->cb_size = 0;
+}
+
 int nfp_net_tx_rings_prepare(struct nfp_net *nn, struct nfp_net_dp *dp)
 {
 	unsigned int r;
@@ -211,12 +260,17 @@ int nfp_net_tx_rings_prepare(struct nfp_net *nn, struct nfp_net_dp *dp)
 
 		if (nfp_net_tx_ring_bufs_alloc(dp, &dp->tx_rings[r]))
 			goto err_free_ring;
+
+		if (nfp_net_tx_ring_cb_alloc(dp, &dp->tx_rings[r]))
+			goto err_free_bufs;
 	}
 
 	return 0;
 
 err_free_prev:
 	while (r--) {
+		nfp_net_tx_ring_cb_free(dp, &dp->tx_rings[r]);
+err_free_bufs:
 		nfp_net_tx_ring_bufs_free(dp, &dp->tx_rings[r]);
 err_free_ring:
 		nfp_net_tx_ring_free(dp, &dp->tx_rings[r]);
@@ -234,6 +288,7 @@ void nfp_net_tx_rings_free(struct nfp_net_dp *dp)
 	unsigned int r;
 
 	for (r = 0; r < dp->num_tx_rings; r++) {
+		nfp_net_tx_ring_cb_free(dp, &dp->tx_rings[r]);
 		nfp_net_tx_ring_bufs_free(dp, &dp->tx_rings[r]);
 		nfp_net_tx_ring_free(dp, &dp->tx_rings[r]);
 	}
@@ -4,8 +4,99 @@
 #ifndef _NFP_NET_DP_
 #define _NFP_NET_DP_
 
+#include <linux/jump_label.h>
+#include <linux/ktime.h>
+
 #include "nfp_net.h"
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 3, 0)
+DECLARE_STATIC_KEY_FALSE(nfp_net_ring_stats_key);
+#define nfp_net_ring_stats_on()	static_branch_unlikely(&nfp_net_ring_stats_key)
+/* Time (ns) ring stats were last enabled, older samples are stale */
+extern u64 nfp_net_ring_stats_epoch;
+#else
+#define nfp_net_ring_stats_on()	false
+#endif
+
+static inline unsigned int nfp_net_hist_bucket(u64 val)
+{
+	return min_t(unsigned int, fls64(val), NFP_NET_HIST_BUCKETS - 1);
+}
+
+/**
+ * nfp_net_ring_stats_poll() - Account one NAPI poll in the ring stats
+ * @r_vec:	Ring vector being polled
+ * @work:	Number of RX packets handled
+ * @budget:	NAPI budget of the poll
+ */
+static inline void
+nfp_net_ring_stats_poll(struct nfp_net_r_vector *r_vec, unsigned int work,
+			int budget)
+{
+	if (!nfp_net_ring_stats_on())
+		return;
+
+	r_vec->ring_stats.poll_work[nfp_net_hist_bucket(work)]++;
+	if (work >= budget)
+		r_vec->ring_stats.budget_exhausted++;
+}
+
+/**
+ * nfp_net_ring_stats_tx_kick() - Sample residency of descriptors being posted
+ * @tx_ring:	TX ring whose write pointer is about to be pushed to the device
+ *
+ * Only one batch of descriptors per ring is tracked at a time, a sample left
+ * over from before the stats were last enabled is replaced.  Called with
+ * the TX queue lock held, races with the completion path only lose samples.
+ */
+static inline void nfp_net_ring_stats_tx_kick(struct nfp_net_tx_ring *tx_ring)
+{
+	u64 ts;
+
+	if (!nfp_net_ring_stats_on() || !tx_ring->wr_ptr_add)
+		return;
+
+	ts = READ_ONCE(tx_ring->lat_ts);
+	if (ts && ts >= READ_ONCE(nfp_net_ring_stats_epoch))
+		return;
+
+	tx_ring->lat_wr_p = tx_ring->wr_p;
+	smp_wmb(); /* publish lat_wr_p before lat_ts */
+	WRITE_ONCE(tx_ring->lat_ts, ktime_get_ns());
+}
+
+/**
+ * nfp_net_ring_stats_tx_done() - Account one TX completion run
+ * @tx_ring:	TX ring, with @tx_ring->rd_p already advanced
+ * @done_pkts:	Number of packets reclaimed
+ */
+static inline void
+nfp_net_ring_stats_tx_done(struct nfp_net_tx_ring *tx_ring, u32 done_pkts)
+{
+	struct nfp_net_ring_stats *stats = &tx_ring->r_vec->ring_stats;
+	u64 ts;
+
+	if (!nfp_net_ring_stats_on())
+		return;
+
+	stats->tx_batch[nfp_net_hist_bucket(done_pkts)]++;
+
+	ts = READ_ONCE(tx_ring->lat_ts);
+	if (!ts)
+		return;
+	if (ts < READ_ONCE(nfp_net_ring_stats_epoch)) {
+		WRITE_ONCE(tx_ring->lat_ts, 0);
+		return;
+	}
+	smp_rmb(); /* pairs with nfp_net_ring_stats_tx_kick() */
+	if ((s32)(tx_ring->rd_p - tx_ring->lat_wr_p) < 0)
+		return;
+
+	ts = div_u64(ktime_get_ns() - ts, NSEC_PER_USEC);
+	stats->tx_residency[nfp_net_hist_bucket(ts)]++;
+	WRITE_ONCE(tx_ring->lat_ts, 0);
+}
+
 static inline dma_addr_t nfp_net_dma_map_rx(struct nfp_net_dp *dp, void *frag)
 {
 	return dma_map_single_attrs(dp->dev, frag + NFP_NET_RX_BUF_HEADROOM,
@@ -62,6 +153,8 @@ static inline int nfp_net_tx_full(struct nfp_net_tx_ring *tx_ring, int dcnt)
 
 static inline void nfp_net_tx_xmit_more_flush(struct nfp_net_tx_ring *tx_ring)
 {
+	nfp_net_ring_stats_tx_kick(tx_ring);
+
 	wmb(); /* drain writebuffer */
 	nfp_qcp_wr_ptr_add(tx_ring->qcp_q, tx_ring->wr_ptr_add);
 	tx_ring->wr_ptr_add = 0;
@@ -75,6 +168,60 @@ nfp_net_read_tx_cmpl(struct nfp_net_tx_ring *tx_ring, struct nfp_net_dp *dp)
 	return nfp_qcp_rd_ptr_read(tx_ring->qcp_q);
 }
 
+/**
+ * nfp_net_tx_can_copybreak() - check if a packet should be copied
+ * @tx_ring: TX ring the packet is sent on
+ * @skb:     Packet to send
+ *
+ * Small linear packets are copied into the ring's premapped bounce area
+ * instead of being DMA mapped, avoiding IOMMU map/unmap for each of them.
+ *
+ * Return: True if the packet should be sent with nfp_net_tx_copybreak().
+ */
+static inline bool
+nfp_net_tx_can_copybreak(const struct nfp_net_tx_ring *tx_ring,
+			 const struct sk_buff *skb)
+{
+	return skb->len <= tx_ring->cb_len && !skb_is_nonlinear(skb);
+}
+
+/**
+ * nfp_net_tx_copybreak() - copy a packet into the bounce area
+ * @tx_ring: TX ring the packet is sent on
+ * @skb:     Packet to copy, must pass nfp_net_tx_can_copybreak()
+ * @slot:    Bounce area slot, owned by the packet's first descriptor
+ *
+ * Return: DMA address of the copy.
+ */
+static inline dma_addr_t
+nfp_net_tx_copybreak(struct nfp_net_tx_ring *tx_ring, struct sk_buff *skb,
+		     unsigned int slot)
+{
+	unsigned int off = slot * tx_ring->cb_stride;
+
+	skb_copy_from_linear_data(skb, tx_ring->cb_buf + off, skb->len);
+
+	u64_stats_update_begin(&tx_ring->r_vec->tx_sync);
+	tx_ring->r_vec->tx_copybreak++;
+	u64_stats_update_end(&tx_ring->r_vec->tx_sync);
+
+	return tx_ring->cb_dma + off;
+}
+
+/**
+ * nfp_net_tx_is_copybreak() - check if a TX buffer is in the bounce area
+ * @tx_ring:  TX ring
+ * @dma_addr: DMA address of the buffer
+ *
+ * Return: True if the buffer must not be unmapped.
+ */
+static inline bool
+nfp_net_tx_is_copybreak(const struct nfp_net_tx_ring *tx_ring,
+			dma_addr_t dma_addr)
+{
+	return dma_addr - tx_ring->cb_dma < tx_ring->cb_size;
+}
+
 static inline void nfp_net_free_frag(void *frag, bool xdp)
 {
 	if (!xdp)
@@ -96,6 +243,30 @@ static inline void nfp_net_irq_unmask(struct nfp_net *nn, unsigned int entry_nr)
 	nn_pci_flush(nn);
 }
 
+/**
+ * nfp_net_napi_complete() - Finish a NAPI poll and rearm the IRQ if allowed
+ * @r_vec:	Ring vector being polled
+ * @work_done:	Number of packets handed to the stack
+ *
+ * napi_complete_done() returns false when the stack wants to keep the vector
+ * in polling mode (busy polling, deferred hard IRQs, GRO flush timer), the
+ * automasked interrupt must then be left masked.  Must be called after all
+ * other RX stats updates of the poll, NAPI may be scheduled on another CPU
+ * as soon as napi_complete_done() returns.
+ */
+static inline void
+nfp_net_napi_complete(struct nfp_net_r_vector *r_vec, int work_done)
+{
+	u64_stats_update_begin(&r_vec->rx_sync);
+	r_vec->polls_done++;
+	u64_stats_update_end(&r_vec->rx_sync);
+
+	if (napi_complete_done(&r_vec->napi, work_done)) {
+		atomic64_inc(&r_vec->irq_rearm);
+		nfp_net_irq_unmask(r_vec->nfp_net, r_vec->irq_entry);
+	}
+}
+
 struct seq_file;
 
 /* Common */
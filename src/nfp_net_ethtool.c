@@ -180,9 +180,9 @@ static const char nfp_tlv_stat_names[][ETH_GSTRING_LEN] = {
 
 #define NN_ET_GLOBAL_STATS_LEN ARRAY_SIZE(nfp_net_et_stats)
 #define NN_ET_SWITCH_STATS_LEN 9
-#define NN_RVEC_GATHER_STATS	13
-#define NN_RVEC_PER_Q_STATS	3
-#define NN_CTRL_PATH_STATS	4
+#define NN_RVEC_GATHER_STATS	20
+#define NN_RVEC_PER_Q_STATS	8
+#define NN_CTRL_PATH_STATS	16
 
 #define SFP_SFF_REV_COMPLIANCE	1
 
@@ -791,6 +791,51 @@ static int nfp_net_set_ringparam(struct net_device *netdev,
 #endif /* VERSION__ETHTOOL_RINGPARAM */
 }
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 18, 0)
+static int nfp_net_get_tunable(struct net_device *netdev,
+			       const struct ethtool_tunable *tuna, void *data)
+{
+	struct nfp_net *nn = netdev_priv(netdev);
+
+	switch (tuna->id) {
+	case ETHTOOL_TX_COPYBREAK:
+		*(u32 *)data = nn->dp.tx_copybreak;
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static int nfp_net_set_tunable(struct net_device *netdev,
+			       const struct ethtool_tunable *tuna,
+			       const void *data)
+{
+	struct nfp_net *nn = netdev_priv(netdev);
+	struct nfp_net_dp *dp;
+	u32 copybreak;
+
+	switch (tuna->id) {
+	case ETHTOOL_TX_COPYBREAK:
+		copybreak = *(u32 *)data;
+		if (copybreak > NFP_NET_TX_COPYBREAK_MAX)
+			return -EINVAL;
+		if (copybreak == nn->dp.tx_copybreak)
+			return 0;
+
+		/* Bounce areas are allocated with the rings */
+		dp = nfp_net_clone_dp(nn);
+		if (!dp)
+			return -ENOMEM;
+
+		dp->tx_copybreak = copybreak;
+
+		return nfp_net_ring_reconfig(nn, dp, NULL);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+#endif /* 3.18 */
+
 static int nfp_test_link(struct net_device *netdev)
 {
 	if (!netif_carrier_ok(netdev) || !(netdev->flags & IFF_UP))
@@ -962,6 +1007,11 @@ static u8 *nfp_vnic_get_sw_stats_strings(struct net_device *netdev, u8 *data)
 		ethtool_sprintf(&data, "rvec_%u_rx_pkts", i);
 		ethtool_sprintf(&data, "rvec_%u_tx_pkts", i);
 		ethtool_sprintf(&data, "rvec_%u_tx_busy", i);
+		ethtool_sprintf(&data, "rvec_%u_tx_nop_slots", i);
+		ethtool_sprintf(&data, "rvec_%u_tx_block_close", i);
+		ethtool_sprintf(&data, "rvec_%u_irqs", i);
+		ethtool_sprintf(&data, "rvec_%u_polls_done", i);
+		ethtool_sprintf(&data, "rvec_%u_irq_rearm", i);
 	}
 
 	ethtool_puts(&data, "hw_rx_csum_ok");
@@ -977,11 +1027,30 @@ static u8 *nfp_vnic_get_sw_stats_strings(struct net_device *netdev, u8 *data)
 	ethtool_puts(&data, "tx_tls_encrypted_packets");
 	ethtool_puts(&data, "tx_tls_ooo");
 	ethtool_puts(&data, "tx_tls_drop_no_sync_data");
+	ethtool_puts(&data, "tx_copybreak");
+	ethtool_puts(&data, "tx_frag_pull");
+	ethtool_puts(&data, "tx_linearize");
+	ethtool_puts(&data, "tx_block_fill");
+	ethtool_puts(&data, "hw_rx_gro_packets");
+	ethtool_puts(&data, "hw_rx_gro_segs");
+	ethtool_puts(&data, "hw_rx_gro_miss");
 
 	ethtool_puts(&data, "hw_tls_no_space");
 	ethtool_puts(&data, "rx_tls_resync_req_ok");
 	ethtool_puts(&data, "rx_tls_resync_req_ign");
 	ethtool_puts(&data, "rx_tls_resync_sent");
+	ethtool_puts(&data, "hw_tls_add");
+	ethtool_puts(&data, "hw_tls_add_time_total_us");
+	ethtool_puts(&data, "hw_tls_del_deferred");
+	ethtool_puts(&data, "mbox_cmsg_batches");
+	ethtool_puts(&data, "mbox_cmsg_batch_msgs");
+	ethtool_puts(&data, "ipsec_sa_add");
+	ethtool_puts(&data, "ipsec_sa_add_fail");
+	ethtool_puts(&data, "ipsec_sa_del");
+	ethtool_puts(&data, "ipsec_cfg_batch");
+	ethtool_puts(&data, "arfs_add");
+	ethtool_puts(&data, "arfs_add_fail");
+	ethtool_puts(&data, "arfs_expire");
 
 	return data;
 }
@@ -1005,12 +1074,21 @@ static u64 *nfp_vnic_get_sw_stats(struct net_device *netdev, u64 *data)
 			tmp[3] = nn->r_vecs[i].hw_csum_rx_error;
 			tmp[4] = nn->r_vecs[i].rx_replace_buf_alloc_fail;
 			tmp[5] = nn->r_vecs[i].hw_tls_rx;
+			tmp[17] = nn->r_vecs[i].hw_gro_rx;
+			tmp[18] = nn->r_vecs[i].hw_gro_rx_segs;
+			tmp[19] = nn->r_vecs[i].hw_gro_rx_miss;
+			data[6] = nn->r_vecs[i].polls_done;
 		} while (u64_stats_fetch_retry(&nn->r_vecs[i].rx_sync, start));
 
+		data[5] = READ_ONCE(nn->r_vecs[i].irqs);
+		data[7] = atomic64_read(&nn->r_vecs[i].irq_rearm);
+
 		do {
 			start = u64_stats_fetch_begin(&nn->r_vecs[i].tx_sync);
 			data[1] = nn->r_vecs[i].tx_pkts;
 			data[2] = nn->r_vecs[i].tx_busy;
+			data[3] = nn->r_vecs[i].tx_nop_slots;
+			data[4] = nn->r_vecs[i].tx_block_close;
 			tmp[6] = nn->r_vecs[i].hw_csum_tx;
 			tmp[7] = nn->r_vecs[i].hw_csum_tx_inner;
 			tmp[8] = nn->r_vecs[i].tx_gather;
@@ -1018,6 +1096,10 @@ static u64 *nfp_vnic_get_sw_stats(struct net_device *netdev, u64 *data)
 			tmp[10] = nn->r_vecs[i].hw_tls_tx;
 			tmp[11] = nn->r_vecs[i].tls_tx_fallback;
 			tmp[12] = nn->r_vecs[i].tls_tx_no_fallback;
+			tmp[13] = nn->r_vecs[i].tx_copybreak;
+			tmp[14] = nn->r_vecs[i].tx_frag_pull;
+			tmp[15] = nn->r_vecs[i].tx_linearize;
+			tmp[16] = nn->r_vecs[i].tx_block_fill;
 		} while (u64_stats_fetch_retry(&nn->r_vecs[i].tx_sync, start));
 
 		data += NN_RVEC_PER_Q_STATS;
@@ -1033,6 +1115,18 @@ static u64 *nfp_vnic_get_sw_stats(struct net_device *netdev, u64 *data)
 	*data++ = atomic_read(&nn->ktls_rx_resync_req);
 	*data++ = atomic_read(&nn->ktls_rx_resync_ign);
 	*data++ = atomic_read(&nn->ktls_rx_resync_sent);
+	*data++ = atomic_read(&nn->ktls_add_cnt);
+	*data++ = div_u64(atomic64_read(&nn->ktls_add_time_ns), NSEC_PER_USEC);
+	*data++ = atomic_read(&nn->ktls_del_deferred);
+	*data++ = atomic64_read(&nn->mbox_cmsg.batches);
+	*data++ = atomic64_read(&nn->mbox_cmsg.batch_msgs);
+	*data++ = atomic_read(&nn->ipsec_sa_add);
+	*data++ = atomic_read(&nn->ipsec_sa_add_fail);
+	*data++ = atomic_read(&nn->ipsec_sa_del);
+	*data++ = atomic_read(&nn->ipsec_cfg_batch);
+	*data++ = atomic_read(&nn->arfs_add);
+	*data++ = atomic_read(&nn->arfs_add_fail);
+	*data++ = atomic_read(&nn->arfs_expire);
 
 	return data;
 }
@@ -1074,12 +1168,16 @@ nfp_vnic_get_hw_stats_strings(u8 *data, unsigned int num_vecs, bool repr)
 }
 
 static u64 *
-nfp_vnic_get_hw_stats(u64 *data, u8 __iomem *mem, unsigned int num_vecs)
+nfp_vnic_get_hw_stats(u64 *data, struct nfp_net *nn, u8 __iomem *mem,
+		      unsigned int num_vecs)
 {
-	unsigned int i;
+	unsigned int i, off;
 
-	for (i = 0; i < NN_ET_GLOBAL_STATS_LEN; i++)
-		*data++ = readq(mem + nfp_net_et_stats[i].off);
+	/* vNICs may serve the stats block from a cached copy */
+	for (i = 0; i < NN_ET_GLOBAL_STATS_LEN; i++) {
+		off = nfp_net_et_stats[i].off;
+		*data++ = nn ? nfp_net_hw_stat_read(nn, off) : readq(mem + off);
+	}
 
 	for (i = 0; i < num_vecs; i++) {
 		*data++ = readq(mem + NFP_NET_CFG_RXR_STATS(i));
@@ -1222,7 +1320,7 @@ nfp_net_get_stats(struct net_device *netdev, struct ethtool_stats *stats,
 
 	data = nfp_vnic_get_sw_stats(netdev, data);
 	if (!nn->tlv_caps.vnic_stats_off)
-		data = nfp_vnic_get_hw_stats(data, nn->dp.ctrl_bar,
+		data = nfp_vnic_get_hw_stats(data, nn, nn->dp.ctrl_bar,
 					     nn->max_r_vecs);
 	else
 		data = nfp_vnic_get_tlv_stats(nn, data);
@@ -1278,7 +1376,7 @@ nfp_port_get_stats(struct net_device *netdev, struct ethtool_stats *stats,
 	struct nfp_port *port = nfp_port_from_netdev(netdev);
 
 	if (nfp_port_is_vnic(port))
-		data = nfp_vnic_get_hw_stats(data, port->vnic, 0);
+		data = nfp_vnic_get_hw_stats(data, NULL, port->vnic, 0);
 	else
 		data = nfp_mac_get_stats(netdev, data);
 	data = nfp_app_port_get_stats(port, data);
@@ -1431,8 +1529,6 @@ static int nfp_net_get_rss_hash_opts(struct nfp_net *nn,
 	return 0;
 }
 
-#define NFP_FS_MAX_ENTRY	1024
-
 static int nfp_net_fs_to_ethtool(struct nfp_fs_entry *entry, struct ethtool_rxnfc *cmd)
 {
 	struct ethtool_rx_flow_spec *fs = &cmd->fs;
@@ -1518,7 +1614,7 @@ static int nfp_net_get_fs_rule(struct nfp_net *nn, struct ethtool_rxnfc *cmd)
 	if (!(nn->cap_w1 & NFP_NET_CFG_CTRL_FLOW_STEER))
 		return -EOPNOTSUPP;
 
-	if (cmd->fs.location >= NFP_FS_MAX_ENTRY)
+	if (cmd->fs.location >= NFP_FS_USER_MAX_ENTRY)
 		return -EINVAL;
 
 	list_for_each_entry(entry, &nn->fs.list, node) {
@@ -1562,7 +1658,7 @@ static int nfp_net_get_rxnfc(struct net_device *netdev,
 	case ETHTOOL_GRXCLSRULE:
 		return nfp_net_get_fs_rule(nn, cmd);
 	case ETHTOOL_GRXCLSRLALL:
-		cmd->data = NFP_FS_MAX_ENTRY;
+		cmd->data = NFP_FS_USER_MAX_ENTRY;
 		return nfp_net_get_fs_loc(nn, rule_locs);
 	case ETHTOOL_GRXFH:
 		return nfp_net_get_rss_hash_opts(nn, cmd);
@@ -1742,7 +1838,7 @@ static int nfp_net_fs_add(struct nfp_net *nn, struct ethtool_rxnfc *cmd)
 		return -EOPNOTSUPP;
 #endif
 
-	if (fs->location >= NFP_FS_MAX_ENTRY)
+	if (fs->location >= NFP_FS_USER_MAX_ENTRY)
 		return -EINVAL;
 
 	if (fs->ring_cookie != RX_CLS_FLOW_DISC &&
@@ -1828,7 +1924,7 @@ static int nfp_net_fs_add(struct nfp_net *nn, struct ethtool_rxnfc *cmd)
 			break;
 	}
 
-	if (nn->fs.count == NFP_FS_MAX_ENTRY) {
+	if (nn->fs.count == NFP_FS_USER_MAX_ENTRY) {
 		err = -ENOSPC;
 		goto err;
 	}
@@ -1855,7 +1951,7 @@ static int nfp_net_fs_del(struct nfp_net *nn, struct ethtool_rxnfc *cmd)
 	if (!(nn->cap_w1 & NFP_NET_CFG_CTRL_FLOW_STEER))
 		return -EOPNOTSUPP;
 
-	if (!nn->fs.count || cmd->fs.location >= NFP_FS_MAX_ENTRY)
+	if (!nn->fs.count || cmd->fs.location >= NFP_FS_USER_MAX_ENTRY)
 		return -EINVAL;
 
 	list_for_each_entry(entry, &nn->fs.list, node) {
@@ -2222,7 +2318,7 @@ nfp_port_get_module_info(struct net_device *netdev,
 		return -EOPNOTSUPP;
 
 	/* update port state to get latest interface */
-	set_bit(NFP_PORT_CHANGED, &port->flags);
+	nfp_net_port_changed(port);
 	eth_port = nfp_port_get_eth_port(port);
 	if (!eth_port)
 		return -EOPNOTSUPP;
@@ -2759,6 +2855,10 @@ static const struct ethtool_ops nfp_net_ethtool_ops = {
 	.get_link		= ethtool_op_get_link,
 	.get_ringparam		= nfp_net_get_ringparam,
 	.set_ringparam		= nfp_net_set_ringparam,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 18, 0)
+	.get_tunable		= nfp_net_get_tunable,
+	.set_tunable		= nfp_net_set_tunable,
+#endif
 	.self_test		= nfp_net_self_test,
 	.get_strings		= nfp_net_get_strings,
 	.get_ethtool_stats	= nfp_net_get_stats,
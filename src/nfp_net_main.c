@@ -13,6 +13,7 @@
 
 #include <linux/etherdevice.h>
 #include <linux/kernel.h>
+#include <linux/kref.h>
 #include <linux/init.h>
 #include <linux/lockdep.h>
 #include <linux/pci.h>
@@ -590,6 +591,107 @@ static void nfp_net_notify_port_speed(struct nfp_port *port)
 	nn_writew(nn, NFP_NET_CFG_STS_NSP_LINK_RATE, nfp_net_speed2lr(port->eth_port->speed));
 }
 
+/*
+ * Port table cache
+ *
+ * Reading the ETH table is a full NSP command, and a single link event
+ * marks every port of the PF changed.  Refreshes share one refcounted
+ * snapshot which is published via RCU and invalidated by bumping
+ * @eth_cache_seq whenever port state may have changed.
+ */
+struct nfp_eth_table_cache {
+	struct kref ref;
+	struct rcu_head rcu;
+	int seq;
+	struct nfp_eth_table *table;
+};
+
+static void nfp_net_eth_cache_release(struct kref *ref)
+{
+	struct nfp_eth_table_cache *cache;
+
+	cache = container_of(ref, struct nfp_eth_table_cache, ref);
+	/* The table is only read with a reference held, RCU readers
+	 * merely look at @seq and @ref of the cache entry itself.
+	 */
+	kfree(cache->table);
+	kfree_rcu(cache, rcu);
+}
+
+static void nfp_net_eth_cache_put(struct nfp_eth_table_cache *cache)
+{
+	kref_put(&cache->ref, nfp_net_eth_cache_release);
+}
+
+/**
+ * nfp_net_eth_cache_get() - get a reference to an up to date ETH table
+ * @pf:		NFP PF handle
+ * @force:	always read the table from the NSP
+ *
+ * Return: referenced cache entry (release with nfp_net_eth_cache_put())
+ *	   or NULL if the table could not be read.
+ */
+static struct nfp_eth_table_cache *
+nfp_net_eth_cache_get(struct nfp_pf *pf, bool force)
+{
+	struct nfp_eth_table_cache *cache, *old;
+
+	if (!force) {
+		rcu_read_lock();
+		cache = rcu_dereference(pf->eth_cache);
+		if (cache && cache->seq == atomic_read(&pf->eth_cache_seq) &&
+		    kref_get_unless_zero(&cache->ref)) {
+			rcu_read_unlock();
+			return cache;
+		}
+		rcu_read_unlock();
+	}
+
+	mutex_lock(&pf->eth_cache_lock);
+	old = rcu_dereference_protected(pf->eth_cache,
+					lockdep_is_held(&pf->eth_cache_lock));
+	/* Someone else may have refreshed the table while we waited */
+	if (!force && old && old->seq == atomic_read(&pf->eth_cache_seq)) {
+		kref_get(&old->ref);
+		cache = old;
+		goto out_unlock;
+	}
+
+	cache = kzalloc(sizeof(*cache), GFP_KERNEL);
+	if (!cache)
+		goto out_unlock;
+
+	/* Sample the sequence first, events during the read will invalidate */
+	cache->seq = atomic_read(&pf->eth_cache_seq);
+	cache->table = nfp_eth_read_ports(pf->cpp);
+	if (!cache->table) {
+		kfree(cache);
+		cache = NULL;
+		goto out_unlock;
+	}
+
+	/* One reference for @pf, one for the caller */
+	kref_init(&cache->ref);
+	kref_get(&cache->ref);
+	rcu_assign_pointer(pf->eth_cache, cache);
+	if (old)
+		nfp_net_eth_cache_put(old);
+out_unlock:
+	mutex_unlock(&pf->eth_cache_lock);
+
+	return cache;
+}
+
+static void nfp_net_eth_cache_clean(struct nfp_pf *pf)
+{
+	struct nfp_eth_table_cache *cache;
+
+	cache = rcu_dereference_protected(pf->eth_cache, true);
+	RCU_INIT_POINTER(pf->eth_cache, NULL);
+	if (cache)
+		nfp_net_eth_cache_put(cache);
+}
+
 static int
 nfp_net_eth_port_update(struct nfp_cpp *cpp, struct nfp_port *port,
 			struct nfp_eth_table *eth_table)
@@ -619,7 +721,7 @@ nfp_net_eth_port_update(struct nfp_cpp *cpp, struct nfp_port *port,
 int nfp_net_refresh_port_table_sync(struct nfp_pf *pf)
 {
 	struct devlink *devlink = priv_to_devlink(pf);
-	struct nfp_eth_table *eth_table;
+	struct nfp_eth_table_cache *eth_cache;
 	struct nfp_net *nn, *next;
 	struct nfp_port *port;
 	int err;
@@ -635,8 +737,9 @@ int nfp_net_refresh_port_table_sync(struct nfp_pf *pf)
 	list_for_each_entry(port, &pf->ports, port_list)
 		clear_bit(NFP_PORT_CHANGED, &port->flags);
 
-	eth_table = nfp_eth_read_ports(pf->cpp);
-	if (!eth_table) {
+	/* Port config may have just changed, don't trust the cache */
+	eth_cache = nfp_net_eth_cache_get(pf, true);
+	if (!eth_cache) {
 		list_for_each_entry(port, &pf->ports, port_list)
 			if (__nfp_port_get_eth_port(port))
 				set_bit(NFP_PORT_CHANGED, &port->flags);
@@ -647,10 +750,11 @@ int nfp_net_refresh_port_table_sync(struct nfp_pf *pf)
 
 	list_for_each_entry(port, &pf->ports, port_list)
 		if (__nfp_port_get_eth_port(port))
-			nfp_net_eth_port_update(pf->cpp, port, eth_table);
+			nfp_net_eth_port_update(pf->cpp, port,
+						eth_cache->table);
 	rtnl_unlock();
 
-	kfree(eth_table);
+	nfp_net_eth_cache_put(eth_cache);
 
 	/* Resync repr state. This may cause reprs to be removed. */
 	err = nfp_reprs_resync_phys_ports(pf->app);
@@ -684,29 +788,42 @@ void nfp_net_refresh_port_table(struct nfp_port *port)
 {
 	struct nfp_pf *pf = port->app->pf;
 
-	set_bit(NFP_PORT_CHANGED, &port->flags);
+	nfp_net_port_changed(port);
 
 	queue_work(pf->wq, &pf->port_refresh_work);
 }
 
+/**
+ * nfp_net_port_changed() - mark port state as stale
+ * @port:	NFP port structure
+ *
+ * Flag @port for refresh and invalidate the PF's cached ETH table, so the
+ * next refresh of any port goes to the NSP.  Safe to call from any context.
+ */
+void nfp_net_port_changed(struct nfp_port *port)
+{
+	set_bit(NFP_PORT_CHANGED, &port->flags);
+	atomic_inc(&port->app->pf->eth_cache_seq);
+}
+
 int nfp_net_refresh_eth_port(struct nfp_port *port)
 {
+	struct nfp_eth_table_cache *eth_cache;
 	struct nfp_cpp *cpp = port->app->cpp;
-	struct nfp_eth_table *eth_table;
 	int ret;
 
 	clear_bit(NFP_PORT_CHANGED, &port->flags);
 
-	eth_table = nfp_eth_read_ports(cpp);
-	if (!eth_table) {
+	eth_cache = nfp_net_eth_cache_get(port->app->pf, false);
+	if (!eth_cache) {
 		set_bit(NFP_PORT_CHANGED, &port->flags);
 		nfp_err(cpp, "Error refreshing port state table!\n");
 		return -EIO;
 	}
 
-	ret = nfp_net_eth_port_update(cpp, port, eth_table);
+	ret = nfp_net_eth_port_update(cpp, port, eth_cache->table);
 
-	kfree(eth_table);
+	nfp_net_eth_cache_put(eth_cache);
 
 	return ret;
 }
@@ -738,6 +855,8 @@ int nfp_net_pci_probe(struct nfp_pf *pf)
 	if (err)
 		return err;
 
+	mutex_init(&pf->eth_cache_lock);
+
 	ctrl_bar = nfp_cpp_area_iomem(pf->data_vnic_bar);
 	qc_bar = nfp_cpp_area_iomem(pf->qc_area);
 	if (!ctrl_bar || !qc_bar) {
@@ -799,6 +918,7 @@ int nfp_net_pci_probe(struct nfp_pf *pf)
 	devl_lock(devlink);
 #endif
 	pf->ddir = nfp_net_debugfs_device_add(pf->pdev);
+	nfp_net_debugfs_nsp_add(pf->cpp, pf->ddir);
 
 	/* Allocate the vnics and do basic init */
 	err = nfp_net_pf_alloc_vnics(pf, ctrl_bar, qc_bar, stride);
@@ -851,6 +971,8 @@ err_devlink_unreg:
 	nfp_net_pf_app_clean(pf);
 err_unmap:
 	nfp_net_pci_unmap_mem(pf);
+	nfp_net_eth_cache_clean(pf);
+	mutex_destroy(&pf->eth_cache_lock);
 	return err;
 }
 
@@ -896,4 +1018,6 @@ void nfp_net_pci_remove(struct nfp_pf *pf)
 	nfp_net_pci_unmap_mem(pf);
 
 	cancel_work_sync(&pf->port_refresh_work);
+	nfp_net_eth_cache_clean(pf);
+	mutex_destroy(&pf->eth_cache_lock);
 }
@@ -125,6 +125,9 @@ struct nfp_eth_table_port *__nfp_port_get_eth_port(struct nfp_port *port)
 	return port->eth_port;
 }
 
+/* Used by all ethtool readers, a stale port is refreshed from the PF's
+ * cached ETH table and only goes to the NSP if that is out of date too.
+ */
 struct nfp_eth_table_port *nfp_port_get_eth_port(struct nfp_port *port)
 {
 	if (!__nfp_port_get_eth_port(port))
@@ -219,6 +219,9 @@ unsigned int nfp_cpp_mu_locality_lsb(struct nfp_cpp *cpp);
 void *nfp_nbi_cache(struct nfp_cpp *cpp);
 void nfp_nbi_cache_set(struct nfp_cpp *cpp, void *val);
 
+void *nfp_nsp_stats_cache(struct nfp_cpp *cpp);
+void nfp_nsp_stats_cache_set(struct nfp_cpp *cpp, void *val);
+
 struct nfp_cpp_area *nfp_cpp_area_alloc_with_name(struct nfp_cpp *cpp,
 						  u32 cpp_id,
 						  const char *name,
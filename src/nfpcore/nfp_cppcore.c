@@ -70,6 +70,9 @@ struct nfp_cpp_resource {
  * Following fields can be used only in probe() or with rtnl held:
  * @nbi:		NBI state
  *
+ * Following fields are only updated with the NSP resource held:
+ * @nsp_stats:		NSP command latency statistics
+ *
  * Following fields use explicit locking:
  * @resource_list:	NFP CPP resource list
  * @resource_lock:	protects @resource_list
@@ -109,6 +112,7 @@ struct nfp_cpp {
 	struct list_head area_cache_list;
 
 	void *nbi;
+	void *nsp_stats;
 };
 
 /* Element of the area_cache_list */
@@ -308,6 +312,7 @@ static void __nfp_cpp_release(struct kref *kref)
 		cpp->op->free(cpp);
 
 	kfree(cpp->nbi);
+	kfree(cpp->nsp_stats);
 
 	write_lock(&nfp_cpp_list_lock);
 	list_del_init(&cpp->list);
@@ -419,6 +424,16 @@ void nfp_nbi_cache_set(struct nfp_cpp *cpp, void *val)
 	cpp->nbi = val;
 }
 
+void *nfp_nsp_stats_cache(struct nfp_cpp *cpp)
+{
+	return cpp->nsp_stats;
+}
+
+void nfp_nsp_stats_cache_set(struct nfp_cpp *cpp, void *val)
+{
+	cpp->nsp_stats = val;
+}
+
 #define NFP_IMB_TGTADDRESSMODECFG_MODE_of(_x)		(((_x) >> 13) & 0x7)
 #define NFP_IMB_TGTADDRESSMODECFG_ADDRMODE		BIT(12)
 #define   NFP_IMB_TGTADDRESSMODECFG_ADDRMODE_32_BIT	0
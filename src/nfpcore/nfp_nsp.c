@@ -20,11 +20,14 @@
 #include <linux/firmware.h>
 #include <linux/kernel.h>
 #include <linux/kthread.h>
+#include <linux/ktime.h>
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 18, 0)
 #include <linux/overflow.h>
 #endif
+#include <linux/seq_file.h>
 #include <linux/sizes.h>
 #include <linux/slab.h>
+#include <linux/vmalloc.h>
 
 #define NFP_SUBSYS "nfp_nsp"
 
@@ -35,6 +38,16 @@
 #define NFP_NSP_TIMEOUT_DEFAULT	30
 #define NFP_NSP_TIMEOUT_BOOT	30
 
+/* Most commands complete within microseconds, poll busily for a short
+ * while before backing off exponentially to the old fixed interval.
+ */
+#define NFP_NSP_POLL_SPIN_NS	(20 * NSEC_PER_USEC)
+#define NFP_NSP_POLL_MIN_US	50
+#define NFP_NSP_POLL_MAX_US	(25 * USEC_PER_MSEC)
+#define NFP_NSP_BOOT_POLL_MAX_MS	25
+
+#define NFP_NSP_STATS_CODES	32
+
 /* Offsets relative to the CSR base */
 #define NSP_STATUS		0x00
 #define   NSP_STATUS_MAGIC	GENMASK_ULL(63, 48)
@@ -112,6 +125,48 @@ enum nfp_nsp_cmd {
 	SPCODE_READ_MEDIA	= 23, /* Get either the supported or advertised media for a port */
 };
 
+static const char * const nfp_nsp_cmd_names[NFP_NSP_STATS_CODES] = {
+	[SPCODE_NOOP]			= "noop",
+	[SPCODE_SOFT_RESET]		= "soft_reset",
+	[SPCODE_FW_DEFAULT]		= "fw_default",
+	[SPCODE_PHY_INIT]		= "phy_init",
+	[SPCODE_MAC_INIT]		= "mac_init",
+	[SPCODE_PHY_RXADAPT]		= "phy_rxadapt",
+	[SPCODE_FW_LOAD]		= "fw_load",
+	[SPCODE_ETH_RESCAN]		= "eth_rescan",
+	[SPCODE_ETH_CONTROL]		= "eth_control",
+	[SPCODE_NSP_WRITE_FLASH]	= "write_flash",
+	[SPCODE_NSP_SENSORS]		= "sensors",
+	[SPCODE_NSP_IDENTIFY]		= "identify",
+	[SPCODE_FW_STORED]		= "fw_stored",
+	[SPCODE_HWINFO_LOOKUP]		= "hwinfo_lookup",
+	[SPCODE_HWINFO_SET]		= "hwinfo_set",
+	[SPCODE_FW_LOADED]		= "fw_loaded",
+	[SPCODE_VERSIONS]		= "versions",
+	[SPCODE_READ_SFF_EEPROM]	= "read_sff_eeprom",
+	[SPCODE_READ_MEDIA]		= "read_media",
+};
+
+/**
+ * struct nfp_nsp_stats - per device NSP command latency statistics
+ * @cmd:	Statistics indexed by command code
+ * @cmd.count:	Number of completed commands
+ * @cmd.errors:	Number of commands which failed
+ * @cmd.total_ns:	Total time from issue to completion
+ * @cmd.max_ns:	Longest time from issue to completion
+ *
+ * Only updated with the NSP resource held, readers may see a torn
+ * update which is fine for debugging.
+ */
+struct nfp_nsp_stats {
+	struct {
+		u64 count;
+		u64 errors;
+		u64 total_ns;
+		u64 max_ns;
+	} cmd[NFP_NSP_STATS_CODES];
+};
+
 struct nfp_nsp_dma_buf {
 	__le32 chunk_cnt;
 	__le32 reserved[3];
@@ -297,6 +352,11 @@ struct nfp_nsp *nfp_nsp_open(struct nfp_cpp *cpp)
 	state->cpp = cpp;
 	state->res = res;
 
+	/* Allocated on first use, the NSP resource serializes us */
+	if (!nfp_nsp_stats_cache(cpp))
+		nfp_nsp_stats_cache_set(cpp, kzalloc(sizeof(struct nfp_nsp_stats),
+						     GFP_KERNEL));
+
 	err = nfp_nsp_check(state);
 	if (err) {
 		nfp_nsp_close(state);
@@ -331,6 +391,9 @@ nfp_nsp_wait_reg(struct nfp_cpp *cpp, u64 *reg, u32 nsp_cpp, u64 addr,
 		 u64 mask, u64 val, u32 timeout_sec)
 {
 	const unsigned long wait_until = jiffies + timeout_sec * HZ;
+	unsigned int delay_us = NFP_NSP_POLL_MIN_US;
+	const ktime_t spin_until = ktime_add_ns(ktime_get(),
+						NFP_NSP_POLL_SPIN_NS);
 	int err;
 
 	for (;;) {
@@ -343,15 +406,68 @@ nfp_nsp_wait_reg(struct nfp_cpp *cpp, u64 *reg, u32 nsp_cpp, u64 addr,
 		if ((*reg & mask) == val)
 			return 0;
 
-		msleep(25);
+		if (ktime_before(ktime_get(), spin_until)) {
+			cpu_relax();
+			continue;
+		}
+
+		usleep_range(delay_us, delay_us + delay_us / 4);
+		delay_us = min_t(unsigned int, delay_us * 2,
+				 NFP_NSP_POLL_MAX_US);
 
 		if (time_after(start_time, wait_until))
 			return -ETIMEDOUT;
 	}
 }
 
+static void
+nfp_nsp_stats_update(struct nfp_nsp *state, u16 code, ktime_t start, int err)
+{
+	struct nfp_nsp_stats *stats = nfp_nsp_stats_cache(state->cpp);
+	u64 ns;
+
+	if (!stats || code >= NFP_NSP_STATS_CODES)
+		return;
+
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	stats->cmd[code].count++;
+	stats->cmd[code].total_ns += ns;
+	stats->cmd[code].max_ns = max(stats->cmd[code].max_ns, ns);
+	if (err < 0)
+		stats->cmd[code].errors++;
+}
+
 /**
- * __nfp_nsp_command() - Execute a command on the NFP Service Processor
+ * nfp_nsp_stats_show() - Print NSP command latency statistics
+ * @cpp:	NFP CPP handle
+ * @file:	seq_file to print to
+ */
+void nfp_nsp_stats_show(struct nfp_cpp *cpp, struct seq_file *file)
+{
+	struct nfp_nsp_stats *stats = nfp_nsp_stats_cache(cpp);
+	unsigned int i;
+
+	if (!stats)
+		return;
+
+	seq_puts(file, "cmd                 count  errors   avg_us     max_us\n");
+	for (i = 0; i < NFP_NSP_STATS_CODES; i++) {
+		u64 count = stats->cmd[i].count;
+
+		if (!count)
+			continue;
+
+		seq_printf(file, "%-16s %8llu %7llu %8llu %10llu\n",
+			   nfp_nsp_cmd_names[i] ?: "unknown", count,
+			   stats->cmd[i].errors,
+			   div_u64(div64_u64(stats->cmd[i].total_ns, count),
+				   NSEC_PER_USEC),
+			   div_u64(stats->cmd[i].max_ns, NSEC_PER_USEC));
+	}
+}
+
+/**
+ * nfp_nsp_command_exec() - Execute a command on the NFP Service Processor
  * @state:	NFP SP state
  * @arg:	NFP command argument structure
  *
@@ -366,7 +482,7 @@ nfp_nsp_wait_reg(struct nfp_cpp *cpp, u64 *reg, u32 nsp_cpp, u64 addr,
  *	-ETIMEDOUT if the NSP took longer than @timeout_sec seconds to complete
  */
 static int
-__nfp_nsp_command(struct nfp_nsp *state, const struct nfp_nsp_command_arg *arg)
+nfp_nsp_command_exec(struct nfp_nsp *state, const struct nfp_nsp_command_arg *arg)
 {
 	u64 reg, ret_val, nsp_base, nsp_buffer, nsp_status, nsp_command;
 	struct nfp_cpp *cpp = state->cpp;
@@ -434,6 +550,18 @@ __nfp_nsp_command(struct nfp_nsp *state, const struct nfp_nsp_command_arg *arg)
 	return ret_val;
 }
 
+static int
+__nfp_nsp_command(struct nfp_nsp *state, const struct nfp_nsp_command_arg *arg)
+{
+	ktime_t start = ktime_get();
+	int ret;
+
+	ret = nfp_nsp_command_exec(state, arg);
+	nfp_nsp_stats_update(state, arg->code, start, ret);
+
+	return ret;
+}
+
 static int nfp_nsp_command(struct nfp_nsp *state, u16 code)
 {
 	const struct nfp_nsp_command_arg arg = {
@@ -628,6 +756,111 @@ exit_free_prev:
 	return ret;
 }
 
+static struct page *nfp_nsp_buf_page(const void *buf)
+{
+	if (is_vmalloc_addr(buf))
+		return vmalloc_to_page(buf);
+	return virt_to_page(buf);
+}
+
+/* Only vmalloc() and linear map buffers have struct pages we can look up,
+ * built-in firmware in .rodata or on-stack buffers have to be bounced.
+ */
+static bool nfp_nsp_buf_streamable(const void *buf, size_t len)
+{
+	if (!buf || !len)
+		return false;
+	if (is_vmalloc_addr(buf))
+		return is_vmalloc_addr(buf + len - 1);
+	return virt_addr_valid(buf) && virt_addr_valid(buf + len - 1);
+}
+
+/**
+ * nfp_nsp_command_buf_dma_stream() - run command with input-only SG DMA
+ * @nsp:	NFP SP handle
+ * @arg:	command with buffer arguments, must not have an output buffer
+ *
+ * Map the pages backing @arg->in_buf for DMA one by one and hand them to
+ * the NSP directly, instead of copying the whole input into freshly
+ * allocated chunks.  Firmware images are large and usually vmalloc()ed,
+ * this saves both the transient allocation and the copy.
+ *
+ * Caller must make sure SG DMA is supported for the command and that DMA
+ * chunk size is at least a page, each segment never crosses a page.
+ *
+ * Return: command return value or -ERRNO
+ */
+static int
+nfp_nsp_command_buf_dma_stream(struct nfp_nsp *nsp,
+			       struct nfp_nsp_command_buf_arg *arg)
+{
+	struct nfp_cpp *cpp = nsp->cpp;
+	struct nfp_nsp_dma_buf *desc;
+	const void *buf = arg->in_buf;
+	dma_addr_t *addrs, dma_desc;
+	unsigned int off, len;
+	struct device *dev;
+	int i, ret, nseg;
+	size_t desc_sz;
+
+	nseg = DIV_ROUND_UP(offset_in_page(buf) + arg->in_size, PAGE_SIZE);
+
+	addrs = kcalloc(nseg, sizeof(*addrs), GFP_KERNEL);
+	if (!addrs)
+		return -ENOMEM;
+
+	desc_sz = struct_size(desc, descs, nseg);
+	desc = kzalloc(desc_sz, GFP_KERNEL);
+	if (!desc) {
+		ret = -ENOMEM;
+		goto exit_free_addrs;
+	}
+
+	dev = nfp_cpp_device(cpp)->parent;
+
+	off = 0;
+	for (i = 0; i < nseg; i++) {
+		len = min_t(unsigned int, arg->in_size - off,
+			    PAGE_SIZE - offset_in_page(buf + off));
+
+		addrs[i] = dma_map_page(dev, nfp_nsp_buf_page(buf + off),
+					offset_in_page(buf + off), len,
+					DMA_TO_DEVICE);
+		ret = dma_mapping_error(dev, addrs[i]);
+		if (ret)
+			goto exit_unmap_prev;
+
+		desc->descs[i].size = cpu_to_le32(len);
+		desc->descs[i].addr = cpu_to_le64(addrs[i]);
+		off += len;
+	}
+	desc->chunk_cnt = cpu_to_le32(nseg);
+
+	dma_desc = dma_map_single(dev, desc, desc_sz, DMA_TO_DEVICE);
+	ret = dma_mapping_error(dev, dma_desc);
+	if (ret)
+		goto exit_unmap_all;
+
+	arg->arg.dma = true;
+	arg->arg.buf = dma_desc;
+	ret = __nfp_nsp_command(nsp, &arg->arg);
+
+	dma_unmap_single(dev, dma_desc, desc_sz, DMA_TO_DEVICE);
+exit_unmap_all:
+	i = nseg;
+exit_unmap_prev:
+	while (--i >= 0)
+		dma_unmap_page(dev, addrs[i], le32_to_cpu(desc->descs[i].size),
+			       DMA_TO_DEVICE);
+	kfree(desc);
+exit_free_addrs:
+	kfree(addrs);
+	if (ret < 0)
+		nfp_err(cpp, "NSP: SG DMA stream failed for command 0x%04x: %d (sz:%d)\n",
+			arg->arg.code, ret, arg->in_size);
+	return ret;
+}
+
 static int
 nfp_nsp_command_buf_dma(struct nfp_nsp *nsp,
 			struct nfp_nsp_command_buf_arg *arg,
@@ -657,6 +890,10 @@ nfp_nsp_command_buf_dma(struct nfp_nsp *nsp,
 		chunk_order = buf_order;
 	} else {
 		chunk_order = min_t(unsigned int, dma_order, PAGE_SHIFT);
+		/* Input-only commands can DMA straight from the caller's pages */
+		if (chunk_order == PAGE_SHIFT && !arg->out_size &&
+		    nfp_nsp_buf_streamable(arg->in_buf, arg->in_size))
+			return nfp_nsp_command_buf_dma_stream(nsp, arg);
 	}
 
 	return nfp_nsp_command_buf_dma_sg(nsp, arg, max_size, chunk_order,
@@ -706,6 +943,7 @@ nfp_nsp_command_buf(struct nfp_nsp *nsp, struct nfp_nsp_command_buf_arg *arg)
 int nfp_nsp_wait(struct nfp_nsp *state)
 {
 	const unsigned long wait_until = jiffies + NFP_NSP_TIMEOUT_BOOT * HZ;
+	unsigned int delay_ms = 1;
 	int err;
 
 	nfp_dbg(state->cpp, "Waiting for NSP to respond (%u sec max).\n",
@@ -718,10 +956,12 @@ int nfp_nsp_wait(struct nfp_nsp *state)
 		if (err != -EAGAIN)
 			break;
 
-		if (msleep_interruptible(25)) {
+		if (msleep_interruptible(delay_ms)) {
 			err = -ERESTARTSYS;
 			break;
 		}
+		delay_ms = min_t(unsigned int, delay_ms * 2,
+				 NFP_NSP_BOOT_POLL_MAX_MS);
 
 		if (time_after(start_time, wait_until)) {
 			err = -ETIMEDOUT;
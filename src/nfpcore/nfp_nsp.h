@@ -10,12 +10,14 @@
 struct firmware;
 struct nfp_cpp;
 struct nfp_nsp;
+struct seq_file;
 
 struct nfp_nsp *nfp_nsp_open(struct nfp_cpp *cpp);
 void nfp_nsp_close(struct nfp_nsp *state);
 u16 nfp_nsp_get_abi_ver_major(struct nfp_nsp *state);
 u16 nfp_nsp_get_abi_ver_minor(struct nfp_nsp *state);
 int nfp_nsp_wait(struct nfp_nsp *state);
+void nfp_nsp_stats_show(struct nfp_cpp *cpp, struct seq_file *file);
 int nfp_nsp_device_soft_reset(struct nfp_nsp *state);
 int nfp_nsp_load_fw(struct nfp_nsp *state, const struct firmware *fw);
 int nfp_nsp_write_flash(struct nfp_nsp *state, const struct firmware *fw);